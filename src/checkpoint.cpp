@@ -0,0 +1,76 @@
+#include "checkpoint.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const std::string MAGIC = "checkpoint";
+const int VERSION = 1;
+
+} // namespace
+
+bool Checkpoint::save(const std::string &path) const {
+  std::string tmp = path + ".tmp";
+
+  {
+    std::ofstream out(tmp);
+
+    out << MAGIC << " " << VERSION << std::endl
+        << "input " << input_size << " " << input << std::endl
+        << "offset " << offset << " " << skip << std::endl
+        << "games " << games << " " << last_id << std::endl
+        << "shard " << shard << " " << shard_bytes << std::endl;
+
+    if (!out.flush())
+      return false;
+  }
+
+#ifdef _WIN32
+  std::remove(path.c_str()); // rename() does not replace on Windows
+#endif
+
+  return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+bool Checkpoint::load(const std::string &path) {
+  std::ifstream in(path);
+  std::string magic, key;
+  int version;
+
+  if (!(in >> magic >> version) || magic != MAGIC || version != VERSION)
+    return false;
+
+  in >> key >> input_size >> std::ws;
+  std::getline(in, input);
+  in >> key >> offset >> skip;
+  in >> key >> games >> last_id;
+  in >> key >> shard >> shard_bytes;
+
+  return !in.fail();
+}
+
+std::string Checkpoint::shard_path(const std::string &output, unsigned shard) {
+  return shard ? output + "." + std::to_string(shard) : output;
+}
+
+bool truncate_file(const std::string &path, uint64_t size) {
+#ifdef _WIN32
+  int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+  bool ok = fd >= 0 && _chsize_s(fd, size) == 0;
+
+  if (fd >= 0)
+    _close(fd);
+
+  return ok;
+#else
+  return truncate(path.c_str(), size) == 0;
+#endif
+}
@@ -0,0 +1,500 @@
+#include "columnar.hpp"
+#include "data_io.hpp"
+#include "featschema.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace Columnar {
+
+namespace {
+
+const char MAGIC[8] = {'\x89', 'C', 'O', 'L', '\r', '\n', '\x1a', '\n'};
+const uint32_t VERSION = 1;
+
+// Extra columns stored after the features, in this order
+const std::vector<std::string> EXTRA = {"Phase", "Weight", "Label"};
+
+// Integers are stored little endian whatever the host
+template <typename T> void put(std::string &out, T v) {
+  for (unsigned i = 0; i < sizeof(T); ++i)
+    out += char(uint64_t(v) >> (8 * i));
+}
+
+template <typename T> bool get(std::istream &in, T &v) {
+  unsigned char b[sizeof(T)];
+  if (!in.read((char *)b, sizeof(T)))
+    return false;
+
+  uint64_t x = 0;
+  for (unsigned i = 0; i < sizeof(T); ++i)
+    x |= uint64_t(b[i]) << (8 * i);
+  v = T(x);
+  return true;
+}
+
+uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+unsigned varint_size(uint64_t v) {
+  unsigned n = 1;
+  while (v >= 0x80)
+    v >>= 7, ++n;
+  return n;
+}
+
+void put_varint(std::string &out, uint64_t v) {
+  while (v >= 0x80) {
+    out += char(v | 0x80);
+    v >>= 7;
+  }
+  out += char(v);
+}
+
+// False if the varint runs past 'end' or past 64 bits
+bool get_varint(const char *&p, const char *end, uint64_t &v) {
+  v = 0;
+  for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+    uint8_t b = *p++;
+    v |= uint64_t(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// A varint of a zigzag int32 value, difference or row index takes 5 bytes at
+// most, so the stats bound the encoded size of a column of 'count' values
+bool valid_stats(const ColumnStats &s, size_t count) {
+  if (s.width > 32 || s.min > s.max || s.nonzero > count)
+    return false;
+
+  switch (s.encoding) {
+  case BITPACK: return s.bytes == (count * s.width + 7) / 8;
+  case VARINT:
+  case DELTA:   return s.bytes >= count && s.bytes <= 5 * uint64_t(count);
+  case SPARSE:  return s.bytes >= 2 * uint64_t(s.nonzero) &&
+                       s.bytes <= 10 * uint64_t(s.nonzero);
+  }
+  return false;
+}
+
+// Bytes left in the stream, or -1 if it cannot tell
+int64_t remaining(std::istream &in) {
+  std::streampos pos = in.tellg();
+  if (pos < 0)
+    return -1;
+
+  in.seekg(0, std::ios::end);
+  std::streampos end = in.tellg();
+  in.seekg(pos);
+  return end - pos;
+}
+
+int32_t float_bits(float f) {
+  int32_t i;
+  std::memcpy(&i, &f, sizeof(i));
+  return i;
+}
+
+float bits_float(int32_t i) {
+  float f;
+  std::memcpy(&f, &i, sizeof(f));
+  return f;
+}
+
+} // namespace
+
+ColumnStats encode(const std::vector<int32_t> &values, std::string &out) {
+  ColumnStats s;
+
+  if (!values.empty())
+    s.min = s.max = values[0];
+
+  uint64_t varint_bytes = 0, delta_bytes = 0, sparse_bytes = 0;
+  int64_t prev = 0;
+  size_t last = 0;
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    int32_t v = values[i];
+
+    s.min = std::min(s.min, v);
+    s.max = std::max(s.max, v);
+    varint_bytes += varint_size(zigzag(v));
+    delta_bytes += varint_size(zigzag(v - prev));
+    prev = v;
+
+    if (v) {
+      ++s.nonzero;
+      sparse_bytes += varint_size(i - last) + varint_size(zigzag(v));
+      last = i;
+    }
+  }
+
+  uint64_t range = uint64_t(int64_t(s.max) - s.min);
+  while (range >> s.width)
+    ++s.width;
+
+  uint64_t bitpack_bytes = (values.size() * s.width + 7) / 8;
+
+  // Ties go to bit packing, which decodes fastest
+  uint64_t best = std::min({varint_bytes, delta_bytes, sparse_bytes});
+
+  if (bitpack_bytes <= best)
+    s.encoding = BITPACK;
+  else
+    s.encoding = best == sparse_bytes ? SPARSE
+                 : best == varint_bytes ? VARINT
+                                        : DELTA;
+
+  size_t start = out.size();
+
+  if (s.encoding == BITPACK) {
+    uint64_t acc = 0;
+    unsigned fill = 0;
+
+    for (int32_t v : values) {
+      acc |= uint64_t(int64_t(v) - s.min) << fill;
+      fill += s.width;
+
+      for (; fill >= 8; fill -= 8, acc >>= 8)
+        out += char(acc);
+    }
+    if (fill)
+      out += char(acc);
+  } else if (s.encoding == SPARSE) {
+    last = 0;
+
+    for (size_t i = 0; i < values.size(); ++i)
+      if (values[i]) {
+        put_varint(out, i - last);
+        put_varint(out, zigzag(values[i]));
+        last = i;
+      }
+  } else {
+    prev = 0;
+
+    for (int32_t v : values) {
+      put_varint(out, zigzag(s.encoding == DELTA ? v - prev : v));
+      prev = v;
+    }
+  }
+
+  s.bytes = out.size() - start;
+  return s;
+}
+
+bool decode(const ColumnStats &s, const char *data, size_t count,
+            std::vector<int32_t> &values) {
+  if (!valid_stats(s, count))
+    return false;
+
+  const char *end = data + s.bytes;
+  values.resize(count);
+
+  if (s.encoding == BITPACK) {
+    const uint8_t *p = (const uint8_t *)data;
+    const uint64_t mask = (uint64_t(1) << s.width) - 1;
+    uint64_t acc = 0;
+    unsigned fill = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+      for (; fill < s.width; fill += 8)
+        acc |= uint64_t(*p++) << fill;
+
+      values[i] = int32_t(s.min + int64_t(acc & mask));
+      acc >>= s.width;
+      fill -= s.width;
+    }
+  } else if (s.encoding == SPARSE) {
+    std::fill(values.begin(), values.end(), 0);
+
+    uint64_t gap, v;
+    for (size_t i = 0, n = 0; n < s.nonzero; ++n) {
+      if (!get_varint(data, end, gap) || gap >= count - i ||
+          (n && !gap) || !get_varint(data, end, v))
+        return false;
+      i += gap;
+      values[i] = int32_t(unzigzag(v));
+    }
+  } else {
+    int64_t prev = 0;
+    uint64_t v;
+
+    for (size_t i = 0; i < count; ++i) {
+      if (!get_varint(data, end, v))
+        return false;
+      values[i] = int32_t(s.encoding == DELTA ? prev + unzigzag(v)
+                                              : unzigzag(v));
+      prev = values[i];
+    }
+  }
+
+  return true;
+}
+
+bool is_columnar(std::istream &in) {
+  return in.peek() == (unsigned char)MAGIC[0];
+}
+
+Writer::Writer(std::ostream &out, const std::vector<std::string> &names,
+               unsigned rows_per_block)
+    : out(out), rows_per_block(rows_per_block),
+      columns(names.size() + EXTRA.size()), row_count(0),
+      encoding_count(SPARSE + 1) {
+
+  std::string header(MAGIC, sizeof(MAGIC));
+  put<uint32_t>(header, VERSION);
+  put<uint64_t>(header, FeatureSchema::hash(names));
+  put<uint32_t>(header, names.size());
+
+  for (const std::string &name : names) {
+    put<uint16_t>(header, name.size());
+    header += name;
+  }
+
+  out.write(header.data(), header.size());
+
+  for (auto &c : columns)
+    c.reserve(rows_per_block);
+}
+
+void Writer::push_back(const std::vector<int32_t> &features, int phase,
+                       float weight, float label) {
+  size_t n = columns.size() - EXTRA.size();
+
+  for (size_t i = 0; i < n; ++i)
+    columns[i].push_back(features[i]);
+
+  columns[n].push_back(phase);
+  columns[n + 1].push_back(float_bits(weight));
+  columns[n + 2].push_back(label > 0 ? 1 : -1);
+
+  ++row_count;
+
+  if (columns[0].size() >= rows_per_block)
+    flush();
+}
+
+bool Writer::mirrored() const {
+  size_t n = columns.size() - EXTRA.size();
+  size_t rows = columns[0].size();
+
+  if (rows % 2)
+    return false;
+
+  for (size_t r = 0; r < rows; r += 2) {
+    for (size_t i = 0; i < n; ++i)
+      if (columns[i][r + 1] != -columns[i][r])
+        return false;
+
+    if (columns[n][r + 1] != columns[n][r] ||
+        columns[n + 1][r + 1] != columns[n + 1][r] ||
+        columns[n + 2][r + 1] != -columns[n + 2][r])
+      return false;
+  }
+
+  return true;
+}
+
+void Writer::flush() {
+  if (columns[0].empty())
+    return;
+
+  bool mirror = mirrored();
+
+  std::string head, data;
+  put<uint32_t>(head, columns[0].size());
+  put<uint8_t>(head, mirror);
+
+  for (auto &c : columns) {
+    if (mirror) {
+      for (size_t r = 0; r < c.size() / 2; ++r)
+        c[r] = c[2 * r];
+      c.resize(c.size() / 2);
+    }
+
+    ColumnStats s = encode(c, data);
+
+    put<uint8_t>(head, s.encoding);
+    put<uint8_t>(head, s.width);
+    put<int32_t>(head, s.min);
+    put<int32_t>(head, s.max);
+    put<uint32_t>(head, s.nonzero);
+    put<uint32_t>(head, s.bytes);
+
+    ++encoding_count[s.encoding];
+    c.clear();
+  }
+
+  out.write(head.data(), head.size());
+  out.write(data.data(), data.size());
+}
+
+Reader::Reader(std::istream &in) : in(in), valid(false), hash(0) {
+  char magic[sizeof(MAGIC)];
+  uint32_t version, count;
+
+  if (!in.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, MAGIC, sizeof(MAGIC)) || !get(in, version) ||
+      version != VERSION || !get(in, hash) || !get(in, count))
+    return;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    uint16_t len;
+    if (!get(in, len))
+      return;
+
+    std::string name(len, '\0');
+    if (!in.read(&name[0], len))
+      return;
+    file_names.push_back(name);
+  }
+
+  valid = FeatureSchema::hash(file_names) == hash;
+  values.resize(file_names.size() + EXTRA.size());
+  project({});
+}
+
+void Reader::project(const std::vector<std::string> &features) {
+  const std::vector<std::string> &cur = FeatureSchema::current().names;
+
+  column = FeatureSchema::remap(file_names, cur);
+  wanted.assign(file_names.size() + EXTRA.size(), false);
+
+  for (unsigned i = 0; i < cur.size(); ++i) {
+    if (!features.empty() &&
+        std::find(features.begin(), features.end(), cur[i]) == features.end())
+      column[i] = -1;
+
+    if (column[i] >= 0)
+      wanted[column[i]] = true;
+  }
+
+  for (unsigned i = 0; i < EXTRA.size(); ++i)
+    wanted[file_names.size() + i] = true;
+}
+
+bool Reader::next(SampleSet<sample_type> &set) {
+  uint32_t rows;
+  uint8_t mirror;
+
+  if (!valid || !get(in, rows) || !get(in, mirror))
+    return false;
+
+  uint32_t stored = mirror ? rows / 2 : rows;
+
+  block_stats.resize(values.size());
+
+  // From here on a failure is a corrupt or truncated block, which ends the
+  // file as not good(). Stats are checked before any column is read, so a
+  // corrupt block cannot make the reader allocate or skip past the file.
+  valid = false;
+  uint64_t block_bytes = 0;
+
+  for (ColumnStats &s : block_stats) {
+    uint8_t encoding;
+    if (!get(in, encoding) || !get(in, s.width) || !get(in, s.min) ||
+        !get(in, s.max) || !get(in, s.nonzero) || !get(in, s.bytes))
+      return false;
+    s.encoding = Encoding(encoding);
+
+    if (!valid_stats(s, stored))
+      return false;
+    block_bytes += s.bytes;
+  }
+
+  int64_t left = remaining(in);
+  if (left >= 0 && block_bytes > uint64_t(left))
+    return false;
+
+  for (size_t c = 0; c < values.size(); ++c) {
+    if (!wanted[c]) {
+      in.seekg(block_stats[c].bytes, std::ios::cur);
+      continue;
+    }
+
+    buffer.resize(block_stats[c].bytes);
+    if (!in.read(&buffer[0], block_stats[c].bytes) ||
+        !decode(block_stats[c], buffer.data(), stored, values[c]))
+      return false;
+  }
+
+  valid = true;
+
+  size_t n = file_names.size();
+  size_t feat_count = column.size();
+
+  for (uint32_t r = 0; r < rows; ++r) {
+    // Odd rows of a mirrored block negate the stored row before them
+    uint32_t k = mirror ? r / 2 : r;
+    float sign = mirror && r % 2 ? -1.0f : 1.0f;
+
+    sample_type sample;
+    sample.set_size(feat_count);
+
+    for (size_t i = 0; i < feat_count; ++i)
+      sample(i) = column[i] < 0 ? 0.0f : sign * values[column[i]][k];
+
+    set.push_back(sample, sign * values[n + 2][k], values[n][k],
+                  bits_float(values[n + 1][k]));
+  }
+
+  return true;
+}
+
+int64_t convert(std::istream &csv, std::ostream &out,
+                unsigned rows_per_block) {
+  std::unique_ptr<Writer> writer;
+  std::vector<unsigned> feature_column;
+  int phase_column = -1, weight_column = -1, label_column = -1;
+  std::vector<int32_t> features;
+  std::string line;
+
+  while (getline(csv, line)) {
+    if (FeatureSchema::is_csv_comment(line))
+      continue;
+
+    std::vector<std::string> cells = split_csv_line(line);
+
+    if (cells.back() == "Label") {
+      std::vector<std::string> names;
+
+      for (unsigned i = 0; i < cells.size(); ++i)
+        if (cells[i] == "Label")
+          label_column = i;
+        else if (cells[i] == "Phase")
+          phase_column = i;
+        else if (cells[i] == "Weight")
+          weight_column = i;
+        else {
+          names.push_back(cells[i]);
+          feature_column.push_back(i);
+        }
+
+      writer.reset(new Writer(out, names, rows_per_block));
+      features.resize(names.size());
+      continue;
+    }
+
+    if (!writer)
+      return -1;
+
+    for (size_t i = 0; i < feature_column.size(); ++i)
+      features[i] = atoi(cells[feature_column[i]].c_str());
+
+    writer->push_back(
+        features,
+        phase_column < 0 ? -1 : atoi(cells[phase_column].c_str()),
+        weight_column < 0 ? 1.0f : atof(cells[weight_column].c_str()),
+        cells[label_column] == "Left" ? 1 : -1);
+  }
+
+  if (!writer)
+    return -1;
+
+  writer->flush();
+  return writer->rows();
+}
+
+} // namespace Columnar
@@ -0,0 +1,151 @@
+#include "dedup.hpp"
+#include <assert.h>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Final mixer of MurmurHash3, spreads the bits of an already random key over
+// the whole word so that table slots and Bloom bits are independent.
+inline uint64_t mix(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+} // namespace
+
+KeySet::KeySet(size_t expected) : count(0), has_zero(false) {
+  size_t size = 16;
+  while (size < 2 * expected)
+    size *= 2;
+
+  table.assign(size, 0);
+}
+
+/// insert() uses linear probing with 0 as the empty marker, the key 0 itself
+/// is tracked by a separate flag. The table is kept at most half full.
+
+bool KeySet::insert(uint64_t key) {
+  if (!key) {
+    bool inserted = !has_zero;
+    has_zero = true;
+    count += inserted;
+    return inserted;
+  }
+
+  size_t mask = table.size() - 1;
+
+  for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+    if (table[i] == key)
+      return false;
+
+    if (!table[i]) {
+      table[i] = key;
+
+      if (2 * ++count > table.size())
+        grow();
+
+      return true;
+    }
+  }
+}
+
+void KeySet::grow() {
+  std::vector<uint64_t> old(2 * table.size(), 0);
+  old.swap(table);
+
+  size_t mask = table.size() - 1;
+
+  for (uint64_t key : old)
+    if (key) {
+      size_t i = mix(key) & mask;
+      while (table[i])
+        i = (i + 1) & mask;
+      table[i] = key;
+    }
+}
+
+BloomFilter::BloomFilter(size_t expected, double fp_rate) : bits_set(0) {
+  assert(fp_rate > 0 && fp_rate < 1);
+
+  double m = -double(expected) * std::log(fp_rate) / (M_LN2 * M_LN2);
+  bit_count = std::max<uint64_t>(64, uint64_t(m));
+  hash_count = std::max(1, int(std::round(m / expected * M_LN2)));
+  bits.assign((bit_count + 63) / 64, 0);
+}
+
+/// insert() derives the bit positions by double hashing: h1 + i * h2.
+
+bool BloomFilter::insert(uint64_t key) {
+  uint64_t h1 = mix(key), h2 = mix(h1) | 1;
+  bool inserted = false;
+
+  for (unsigned i = 0; i < hash_count; ++i) {
+    uint64_t b = (h1 + i * h2) % bit_count;
+    uint64_t mask = 1ULL << (b & 63);
+
+    if (!(bits[b / 64] & mask)) {
+      bits[b / 64] |= mask;
+      ++bits_set;
+      inserted = true;
+    }
+  }
+
+  return inserted;
+}
+
+double BloomFilter::cardinality() const {
+  double m = double(bit_count);
+  return -m / hash_count * std::log(1.0 - double(bits_set) / m);
+}
+
+Dedup::Dedup(Mode mode, size_t expected, double fp_rate)
+    : mode(mode), exact(mode == EXACT ? expected : 1),
+      bloom(mode == BLOOM ? expected : 1, fp_rate), seen(0), kept(0) {}
+
+Dedup::Mode Dedup::mode_from_name(const std::string &name) {
+  if (name == "none")
+    return NONE;
+  else if (name == "exact")
+    return EXACT;
+  else if (name == "bloom")
+    return BLOOM;
+
+  throw std::invalid_argument("Unknown dedup mode '" + name + "'");
+}
+
+// The pair is ordered: (a, b) and (b, a) are different comparisons
+uint64_t Dedup::pair_key(uint64_t left_key, uint64_t right_key) {
+  return mix(left_key) ^ (right_key << 1 | right_key >> 63);
+}
+
+bool Dedup::insert(uint64_t left_key, uint64_t right_key) {
+  uint64_t key = pair_key(left_key, right_key);
+  bool inserted = mode == EXACT ? exact.insert(key)
+                  : mode == BLOOM ? bloom.insert(key)
+                                  : true;
+  ++seen;
+  kept += inserted;
+
+  return inserted;
+}
+
+std::string Dedup::report() const {
+  std::stringstream ss;
+
+  ss << "Position pairs: " << seen << "    kept: " << kept
+     << "    duplicates dropped: " << seen - kept;
+
+  if (mode == EXACT)
+    ss << "    distinct: " << exact.size();
+  else if (mode == BLOOM)
+    ss << "    distinct (estimated): " << uint64_t(bloom.cardinality())
+       << "    filter bytes: " << bloom.bytes();
+
+  return ss.str();
+}
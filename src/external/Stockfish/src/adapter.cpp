@@ -12,12 +12,27 @@ void Adapter::hello_from_stockfish() {
 
 static bool INIT_RUN = false;
 
-std::vector<std::string>
-Adapter::run_uci_commands(std::vector<std::string> commands) {
+void Adapter::init() {
   if (!INIT_RUN) {
     Init::init();
+
+    // Every run_uci_commands() starts a new game, which would zero the whole
+    // transposition table before each short search
+    Options["Lazy Clear Hash"] = std::string("true");
+
     INIT_RUN = true;
   }
+}
+
+void Adapter::set_option(const std::string &name, const std::string &value) {
+  init();
+
+  Options[name] = value;
+}
+
+std::vector<std::string>
+Adapter::run_uci_commands(std::vector<std::string> commands) {
+  init();
 
   std::streambuf *cout_sbuf = std::cout.rdbuf();
   std::stringstream ss;
@@ -6,6 +6,10 @@
 
 namespace Adapter {
 void hello_from_stockfish();
+// Initializes the engine globals once, needed before any Position is used
+void init();
+// Sets a UCI option of the engine, as 'setoption name <name> value <value>'
+void set_option(const std::string &name, const std::string &value);
 std::vector<std::string> run_uci_commands(std::vector<std::string> commands);
 } // namespace Adapter
 
@@ -27,6 +27,7 @@
 #include "position.h"
 #include "search.h"
 #include "thread.h"
+#include "tt.h"
 #include "uci.h"
 
 using namespace std;
@@ -153,6 +154,10 @@ void benchmark(const Position& current, istream& is, string mode) {
   TimePoint elapsed = now();
   Position pos;
 
+#ifdef TT_STATS
+  TT.reset_stats();
+#endif
+
   for (size_t i = 0; i < fens.size(); ++i)
   {
       StateListPtr states(new std::deque<StateInfo>(1));
@@ -180,4 +185,8 @@ void benchmark(const Position& current, istream& is, string mode) {
        << "\nTotal time (ms) : " << elapsed
        << "\nNodes searched  : " << nodes
        << "\nNodes/second    : " << 1000 * nodes / elapsed << endl;
+
+#ifdef TT_STATS
+  TT.print_stats(cerr);
+#endif
 }
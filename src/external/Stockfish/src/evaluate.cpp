@@ -84,7 +84,7 @@ namespace {
     Evaluation& operator=(const Evaluation&) = delete;
 
     Value value(bool force_eval);
-    void value_feat(ValueFeat& white_features, ValueFeat &black_features, bool force_eval);
+    Phase value_feat(ValueFeat& white_features, ValueFeat &black_features, bool force_eval);
 
   private:
     // Evaluation helpers (used when calling value())
@@ -1433,8 +1433,8 @@ namespace {
   }
 
   template<Tracing T>
-  void Evaluation<T>::value_feat(ValueFeat &white_features,
-                                 ValueFeat &black_features, bool force_eval) {
+  Phase Evaluation<T>::value_feat(ValueFeat &white_features,
+                                  ValueFeat &black_features, bool force_eval) {
 
     // Main evaluation begins here
 
@@ -1478,6 +1478,8 @@ namespace {
     evaluate_feat_mobility<BLACK, KNIGHT>(black_features);
     evaluate_feat_mobility<BLACK, QUEEN>(black_features);
     evaluate_feat_mobility<BLACK, ROOK>(black_features);
+
+    return me->game_phase();
   }
 } // namespace
 
@@ -1492,19 +1494,16 @@ Value Eval::evaluate(const Position& pos)
 
 Value Eval::evaluate2(const Position& pos) {
   ValueFeat white_features, black_features;
-  Evaluation<>(pos).value_feat(white_features, black_features, true);
+  Phase phase = Evaluation<>(pos).value_feat(white_features, black_features, true);
 
-  CompFeat left(white_features, black_features), right;
+  CompFeat left(white_features, black_features, phase), right;
   float x = comp_value(left, right);
 
-  if (x > 50)
-    return VALUE_KNOWN_WIN;
-  else if (x < -50)
-    return -VALUE_KNOWN_WIN;
-  else if (x >= 0)
-    return Value(int(2000.0 * x));
-  else
-    return -Value(int(2000.0 * x));
+  // The network output is unbounded, keep the score inside the range of the
+  // search (and of the 16 bit transposition table values) with its sign
+  const float limit = float(VALUE_KNOWN_WIN) / 2000;
+
+  return Value(int(2000.0 * std::max(-limit, std::min(limit, x))));
 }
 
 void Eval::evaluate_features(const Position& pos, ValueFeat& white_features,
@@ -1516,9 +1515,9 @@ void Eval::evaluate_features(const Position& pos, ValueFeat& white_features,
 CompFeat Eval::evaluate_comp_features(const Position& pos)
 {
   ValueFeat white_features, black_features;
-  Evaluation<>(pos).value_feat(white_features, black_features, true);
+  Phase phase = Evaluation<>(pos).value_feat(white_features, black_features, true);
 
-  return CompFeat(white_features, black_features);
+  return CompFeat(white_features, black_features, phase);
 }
 
 /// trace() is like evaluate(), but instead of returning a value, it returns
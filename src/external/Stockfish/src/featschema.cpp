@@ -0,0 +1,219 @@
+#include "featschema.h"
+#include <dlib/serialize.h>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// Must list the features in exactly the same order as enum FeatureName
+const std::string FeatureNames[] = {
+    "BISHOP__MINOR_BEHIND_PAWN",
+    "BISHOP__PAWN_SUPPORTED_OCCUPIED_OUTPOST",
+    "BISHOP__PAWN_SUPPORTED_REACHABLE_OUTPOST",
+    "BISHOP__PAWN_UNSUPPORTED_OCCUPIED_OUTPOST",
+    "BISHOP__PAWN_UNSUPPORTED_REACHABLE_OUTPOST",
+    "BISHOP__PAWNS_ON_SAME_COLOR_SQUARES",
+    "KING__CASTLE_KING_SIDE",
+    "KING__CASTLE_QUEEN_SIDE",
+    "KING__CLOSE_ENEMIES_ONE",
+    "KING__CLOSE_ENEMIES_TWO",
+    "KING__ENEMY_OTHER_BISHOP_CHECK",
+    "KING__ENEMY_OTHER_KNIGHT_CHECK",
+    "KING__ENEMY_OTHER_ROOK_CHECK",
+    "KING__ENEMY_SAFE_BISHOP_CHECK",
+    "KING__ENEMY_SAFE_KNIGHT_CHECK",
+    "KING__ENEMY_SAFE_QUEEN_CHECK",
+    "KING__ENEMY_SAFE_ROOK_CHECK",
+    "KING__KING_ADJ_ZONE_ATTACKS_COUNT",
+    "KING__KING_ATTACKERS_COUNT",
+    "KING__KING_ONLY_DEFENDED",
+    "KING__MIN_KING_PAWN_DISTANCE",
+    "KING__NOT_DEFENDED_LARGER_KING_RING",
+    "KING__PAWNLESS_FLANK",
+    "KING__SHELTER_RANK_US",
+    "KING__SHELTER_STORM_EDGE_DISTANCE",
+    "KING__STORM_RANK_THEM",
+    "KING__STORM_TYPE_BLOCKED_BY_KING",
+    "KING__STORM_TYPE_BLOCKED_BY_PAWN",
+    "KING__STORM_TYPE_UNBLOCKED",
+    "KING__STORM_TYPE_UNOPPOSED",
+    "KNIGHT__MINOR_BEHIND_PAWN",
+    "KNIGHT__PAWN_SUPPORTED_OCCUPIED_OUTPOST",
+    "KNIGHT__PAWN_SUPPORTED_REACHABLE_OUTPOST",
+    "KNIGHT__PAWN_UNSUPPORTED_OCCUPIED_OUTPOST",
+    "KNIGHT__PAWN_UNSUPPORTED_REACHABLE_OUTPOST",
+    "MATERIAL__BISHOP",
+    "MATERIAL__KNIGHT",
+    "MATERIAL__PAWN",
+    "MATERIAL__QUEEN",
+    "MATERIAL__ROOK",
+    "MOBILITY__ALL",
+    "MOBILITY__BISHOP",
+    "MOBILITY__KNIGHT",
+    "MOBILITY__QUEEN",
+    "MOBILITY__ROOK",
+    "PASSED_PAWNS__AVERAGE_CANDIDATE_PASSERS",
+    "PASSED_PAWNS__BLOCKSQ_OUR_KING_DISTANCE",
+    "PASSED_PAWNS__BLOCKSQ_THEIR_KING_DISTANCE",
+    "PASSED_PAWNS__DEFENDED_BLOCK_SQUARE",
+    "PASSED_PAWNS__EMPTY_BLOCKSQ",
+    "PASSED_PAWNS__FRIENDLY_OCCUPIED_BLOCKSQ",
+    "PASSED_PAWNS__FULLY_DEFENDED_PATH",
+    "PASSED_PAWNS__HINDERED_PASSED_PAWN",
+    "PASSED_PAWNS__NO_UNSAFE_BLOCKSQ",
+    "PASSED_PAWNS__NO_UNSAFE_SQUARES",
+    "PASSED_PAWNS__TWO_BLOCKSQ_OUR_KING_DISTANCE",
+    "QUEEN__WEAK",
+    "ROOK__CASTLE",
+    "ROOK__ROOK_ON_OPEN_FILE",
+    "ROOK__ROOK_ON_PAWN",
+    "ROOK__ROOK_ON_SEMI_OPEN_FILE",
+    "ROOK__TRAPPED",
+    "SPACE__EXTRA_SAFE_SQUARES",
+    "SPACE__SAFE_SQUARES",
+    "THREATS__HANGING",
+    "THREATS__HANGING_PAWN",
+    "THREATS__KING_THREAT_BY_MINOR",
+    "THREATS__KING_THREAT_BY_ROOK",
+    "THREATS__MINOR_THREAT_BY_MINOR",
+    "THREATS__MINOR_THREAT_BY_ROOK",
+    "THREATS__PAWN_PUSH",
+    "THREATS__PAWN_THREAT_BY_MINOR",
+    "THREATS__PAWN_THREAT_BY_ROOK",
+    "THREATS__QUEEN_THREAT_BY_MINOR",
+    "THREATS__QUEEN_THREAT_BY_ROOK",
+    "THREATS__ROOK_THREAT_BY_MINOR",
+    "THREATS__ROOK_THREAT_BY_ROOK",
+    "THREATS__SAFE_PAWN",
+    "THREATS__THREAT_BY_KING",
+    "THREATS__THREAT_BY_MINOR_RANK",
+    "THREATS__THREAT_BY_ROOK_RANK",
+};
+
+static_assert(sizeof(FeatureNames) / sizeof(FeatureNames[0]) == FEATURE_COUNT,
+              "FeatureNames is out of sync with enum FeatureName");
+
+const std::string MODEL_MAGIC = "poscomp-schema";
+const std::string CSV_MAGIC = "#schema";
+
+} // namespace
+
+const std::string &FeatureSchema::name(FeatureName f) {
+  return FeatureNames[f];
+}
+
+/// hash() is 64 bit FNV-1a over the comma separated feature names, so it
+/// changes whenever a feature is added, removed, renamed or reordered.
+
+uint64_t FeatureSchema::hash(const std::vector<std::string> &names) {
+  uint64_t h = 14695981039346656037ULL;
+
+  for (const std::string &n : names)
+    for (unsigned char c : n + ',')
+      h = (h ^ c) * 1099511628211ULL;
+
+  return h;
+}
+
+std::string FeatureSchema::hex(uint64_t hash) {
+  std::stringstream ss;
+  ss << std::hex << std::setfill('0') << std::setw(16) << hash;
+  return ss.str();
+}
+
+const FeatureSchema::Descriptor &FeatureSchema::current() {
+  static Descriptor d;
+
+  if (d.names.empty()) {
+    d.names.assign(FeatureNames, FeatureNames + FEATURE_COUNT);
+    d.hash = hash(d.names);
+  }
+
+  return d;
+}
+
+std::vector<int> FeatureSchema::remap(const std::vector<std::string> &from,
+                                      const std::vector<std::string> &to) {
+  std::vector<int> map(to.size(), -1);
+
+  for (unsigned i = 0; i < to.size(); ++i)
+    for (unsigned j = 0; j < from.size(); ++j)
+      if (from[j] == to[i]) {
+        map[i] = j;
+        break;
+      }
+
+  return map;
+}
+
+std::string FeatureSchema::csv_comment(const Descriptor &d) {
+  return CSV_MAGIC + " " + std::to_string(Version) + " " + hex(d.hash) + " " +
+         std::to_string(d.names.size());
+}
+
+std::string FeatureSchema::csv_header(const Descriptor &d) {
+  std::string header;
+
+  for (const std::string &n : d.names)
+    header += n + ',';
+
+  return header + "Phase,Weight,Label";
+}
+
+bool FeatureSchema::is_csv_comment(const std::string &line) {
+  return line.compare(0, CSV_MAGIC.size(), CSV_MAGIC) == 0;
+}
+
+bool FeatureSchema::from_csv_comment(const std::string &line, uint64_t &hash,
+                                     unsigned &count) {
+  std::stringstream ss(line);
+  std::string magic;
+  int version;
+
+  ss >> magic >> version >> std::hex >> hash >> std::dec >> count;
+
+  return !ss.fail() && magic == CSV_MAGIC && version == Version;
+}
+
+void FeatureSchema::serialize(const Descriptor &d, std::ostream &out) {
+  dlib::serialize(MODEL_MAGIC, out);
+  dlib::serialize(Version, out);
+  dlib::serialize(d.names, out);
+  dlib::serialize(d.hash, out);
+}
+
+/// deserialize() reads a descriptor written by serialize(). Model files saved
+/// before the schema existed start directly with the network: in that case the
+/// stream is rewound and false is returned.
+
+bool FeatureSchema::deserialize(Descriptor &d, std::istream &in) {
+  std::streampos start = in.tellg();
+  std::string magic;
+
+  try {
+    dlib::deserialize(magic, in);
+  } catch (dlib::serialization_error &) {
+    magic.clear();
+  }
+
+  if (magic != MODEL_MAGIC) {
+    in.clear();
+    in.seekg(start);
+    return false;
+  }
+
+  int version;
+  dlib::deserialize(version, in);
+
+  if (version != Version)
+    throw dlib::serialization_error("Unsupported feature schema version " +
+                                    std::to_string(version));
+
+  dlib::deserialize(d.names, in);
+  dlib::deserialize(d.hash, in);
+
+  if (d.hash != hash(d.names))
+    throw dlib::serialization_error("Corrupted feature schema in model file");
+
+  return true;
+}
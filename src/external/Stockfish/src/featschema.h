@@ -0,0 +1,51 @@
+#ifndef FEAT_SCHEMA_INCLUDED
+#define FEAT_SCHEMA_INCLUDED
+
+#include "types.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// FeatureSchema describes the layout of the comparator input: the names of
+/// the features in FeatureName order and a hash over them. The descriptor is
+/// written into every generated dataset and every model file so that a model
+/// or a dataset produced by a binary with a different FeatureName enum is
+/// detected (and remapped by name) instead of being silently misaligned.
+
+namespace FeatureSchema {
+
+const int Version = 1;
+
+struct Descriptor {
+  std::vector<std::string> names;
+  uint64_t hash;
+
+  bool operator==(const Descriptor &d) const { return hash == d.hash; }
+  bool operator!=(const Descriptor &d) const { return hash != d.hash; }
+};
+
+const std::string &name(FeatureName f);
+uint64_t hash(const std::vector<std::string> &names);
+std::string hex(uint64_t hash);
+const Descriptor &current();
+
+// For every name in 'to', the index of the same name in 'from', or -1 when
+// 'from' has no such column.
+std::vector<int> remap(const std::vector<std::string> &from,
+                       const std::vector<std::string> &to);
+
+// Dataset header: a '#schema' comment line followed by the CSV header row.
+// Besides the features a row has a 'Phase' (Material game phase, -1 if
+// unknown), a 'Weight' (trainer loss weight) and a 'Label' column.
+std::string csv_comment(const Descriptor &d);
+std::string csv_header(const Descriptor &d);
+bool is_csv_comment(const std::string &line);
+bool from_csv_comment(const std::string &line, uint64_t &hash, unsigned &count);
+
+// Model header, written with dlib serialization in front of the network.
+void serialize(const Descriptor &d, std::ostream &out);
+bool deserialize(Descriptor &d, std::istream &in);
+
+} // namespace FeatureSchema
+
+#endif // #ifndef FEAT_SCHEMA_INCLUDED
@@ -36,6 +36,21 @@ typedef bool(*fun3_t)(HANDLE, CONST GROUP_AFFINITY*, PGROUP_AFFINITY);
 }
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -211,9 +226,300 @@ void prefetch2(void* addr) {
   prefetch((uint8_t*)addr + 64);
 }
 
-namespace WinProcGroup {
+/// aligned_malloc() returns memory aligned to 'alignment', a power of two
+/// multiple of sizeof(void*), or nullptr. It is released with aligned_free().
+
+void* aligned_malloc(size_t alignment, size_t size) {
+
+#if defined(_WIN32)
+  return _aligned_malloc(size, alignment);
+#else
+  void* mem;
+  return posix_memalign(&mem, alignment, size) ? nullptr : mem;
+#endif
+}
+
+void aligned_free(void* mem) {
+
+#if defined(_WIN32)
+  _aligned_free(mem);
+#else
+  free(mem);
+#endif
+}
+
+
+/// aligned_large_pages_alloc() returns memory for a large table, aligned to a
+/// 2MB boundary. On Linux the memory is mmap'ed: from the explicit huge pages
+/// reserved by the administrator (MAP_HUGETLB) if there are enough of them,
+/// otherwise from normal pages marked for transparent huge pages, which the
+/// kernel backs with 2MB pages as they are touched. With 4KB pages every
+/// probe of a multi-GB table is a TLB miss. Elsewhere it is a plain aligned
+/// allocation. The memory is not guaranteed to be zeroed.
+
+namespace {
+
+const size_t LargePageSize = 2 * 1024 * 1024;
+
+size_t large_pages_size(size_t size) {
+  return (size + LargePageSize - 1) & ~(LargePageSize - 1);
+}
+
+} // namespace
+
+void* aligned_large_pages_alloc(size_t size) {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+  size = large_pages_size(size);
+
+#ifdef MAP_HUGETLB
+  void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (mem != MAP_FAILED)
+      return mem;
+#endif
+
+  // Transparent huge pages need a 2MB aligned range: map one page more than
+  // needed and unmap what sticks out on either side of the aligned range.
+  char* raw = (char*)mmap(nullptr, size + LargePageSize, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == (char*)MAP_FAILED)
+      return nullptr;
+
+  char* aligned = (char*)((uintptr_t(raw) + LargePageSize - 1) & ~(LargePageSize - 1));
+
+  if (aligned > raw)
+      munmap(raw, aligned - raw);
+  if (raw + LargePageSize > aligned)
+      munmap(aligned + size, raw + LargePageSize - aligned);
+
+#ifdef MADV_HUGEPAGE
+  madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+
+  return aligned;
+
+#elif defined(_WIN32)
+
+  return _aligned_malloc(size, LargePageSize);
+
+#else
+
+  void* mem;
+  return posix_memalign(&mem, LargePageSize, size) ? nullptr : mem;
+
+#endif
+}
+
+
+/// aligned_large_pages_free() releases memory of aligned_large_pages_alloc(),
+/// 'size' is the size it was allocated with.
+
+void aligned_large_pages_free(void* mem, size_t size) {
+
+  if (!mem)
+      return;
+
+#if defined(__linux__) && !defined(__ANDROID__)
+  munmap(mem, large_pages_size(size));
+#elif defined(_WIN32)
+  _aligned_free(mem);
+#else
+  (void)size;
+  free(mem);
+#endif
+}
+
+
+/// shared_memory_attach() maps the POSIX shared memory object 'name' (e.g.
+/// "/sf-hash"), creating it if needed, so that every process attaching to the
+/// same name shares the memory. The first process sizes the object, a new one
+/// is zeroed. Returns nullptr if it cannot be mapped or already exists with
+/// another size, and always on Windows. The object outlives the processes,
+/// until removed with shm_unlink() (or from /dev/shm on Linux).
+
+void* shared_memory_attach(const std::string& name, size_t size) {
+
+#ifndef _WIN32
+
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+
+  if (fd == -1)
+      return nullptr;
+
+  struct stat statbuf;
+  void* mem = MAP_FAILED;
+
+  if (   !fstat(fd, &statbuf)
+      && (statbuf.st_size == off_t(size) || (!statbuf.st_size && !ftruncate(fd, size))))
+      mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  ::close(fd);
+
+  if (mem == MAP_FAILED)
+      return nullptr;
+
+#ifdef MADV_HUGEPAGE
+  madvise(mem, size, MADV_HUGEPAGE); // Honoured if shmem_enabled allows it
+#endif
+
+  return mem;
+
+#else
+
+  (void)name;
+  (void)size;
+  return nullptr;
+
+#endif
+}
+
+
+/// shared_memory_detach() unmaps memory of shared_memory_attach(), the shared
+/// memory object itself is left to the other processes.
+
+void shared_memory_detach(void* mem, size_t size) {
 
 #ifndef _WIN32
+  if (mem)
+      munmap(mem, size);
+#else
+  (void)mem;
+  (void)size;
+#endif
+}
+
+namespace WinProcGroup {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+/// read_cpu_list() reads a list of logical processors in the format of /sys,
+/// like "0-3,8-11", from the given file. Empty if there is no such file.
+
+std::vector<int> read_cpu_list(const std::string& fname) {
+
+  std::ifstream file(fname);
+  std::vector<int> cpus;
+  std::string range;
+
+  while (std::getline(file, range, ','))
+  {
+      int first, last;
+      int n = sscanf(range.c_str(), "%d-%d", &first, &last);
+
+      if (n < 1)
+          continue;
+
+      for (int c = first; c <= (n == 2 ? last : first); ++c)
+          cpus.push_back(c);
+  }
+
+  return cpus;
+}
+
+
+/// allowed_cpus() returns the logical processors the process may run on. It is
+/// read once, by the first thread to bind, before any thread is pinned: the
+/// mask of a pinned thread would be its own processor only.
+
+const cpu_set_t& allowed_cpus() {
+
+  static const cpu_set_t allowed = []() {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      sched_getaffinity(0, sizeof(set), &set);
+      return set;
+  }();
+
+  return allowed;
+}
+
+
+/// get_cpus() returns the logical processors in the order they are given to
+/// the threads by Threads.binding, read from /sys. Within a NUMA node the
+/// first logical processor of every physical core comes before its SMT
+/// siblings. "compact" fills a node before moving on to the next one,
+/// "spread" takes the nodes in turn. Only the processors this process may run
+/// on are used, so that an affinity set by the user (e.g. with taskset) holds.
+/// Empty with the "none" policy.
+
+std::vector<int> get_cpus() {
+
+  if (Threads.binding == "none")
+      return std::vector<int>();
+
+  std::vector<std::vector<int>> nodes;
+
+  for (int n = 0; ; ++n)
+  {
+      std::vector<int> cpus = read_cpu_list("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+
+      if (cpus.empty() && n > 0)
+          break;
+
+      nodes.push_back(cpus.empty() ? read_cpu_list("/sys/devices/system/cpu/online") : cpus);
+  }
+
+  const cpu_set_t& allowed = allowed_cpus();
+
+  for (auto& node : nodes)
+  {
+      std::vector<int> first, siblings;
+
+      for (int c : node)
+      {
+          if (c >= CPU_SETSIZE || !CPU_ISSET(c, &allowed))
+              continue;
+
+          std::vector<int> smt = read_cpu_list("/sys/devices/system/cpu/cpu" + std::to_string(c)
+                                              + "/topology/thread_siblings_list");
+
+          (smt.empty() || c == *std::min_element(smt.begin(), smt.end()) ? first : siblings).push_back(c);
+      }
+
+      node = first;
+      node.insert(node.end(), siblings.begin(), siblings.end());
+  }
+
+  std::vector<int> cpus;
+
+  if (Threads.binding == "compact")
+      for (auto& node : nodes)
+          cpus.insert(cpus.end(), node.begin(), node.end());
+
+  else if (Threads.binding == "spread")
+      for (size_t i = 0; i < CPU_SETSIZE; ++i)
+          for (auto& node : nodes)
+              if (i < node.size())
+                  cpus.push_back(node[i]);
+
+  return cpus;
+}
+
+
+/// bindThisThread() pins the current thread to the logical processor of index
+/// idx in the order of get_cpus(). Threads beyond the number of processors,
+/// and all of them with the "none" policy, are left to the OS on all the
+/// processors of the process, which also undoes an earlier pinning. A thread
+/// binds before its per-thread tables are first touched, so that with the
+/// kernel's first touch policy their memory is on the thread's node.
+
+void bindThisThread(size_t idx) {
+
+  std::vector<int> cpus = get_cpus();
+  cpu_set_t cpuset = allowed_cpus();
+
+  if (idx < cpus.size())
+  {
+      CPU_ZERO(&cpuset);
+      CPU_SET(cpus[idx], &cpuset);
+  }
+
+  pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+}
+
+#elif !defined(_WIN32)
 
 void bindThisThread(size_t) {}
 
@@ -33,6 +33,12 @@ const std::string engine_info(bool to_uci = false);
 void prefetch(void* addr);
 void prefetch2(void* addr);
 void start_logger(const std::string& fname);
+void* aligned_malloc(size_t alignment, size_t size);
+void aligned_free(void* mem);
+void* aligned_large_pages_alloc(size_t size);
+void aligned_large_pages_free(void* mem, size_t size);
+void* shared_memory_attach(const std::string& name, size_t size);
+void shared_memory_detach(void* mem, size_t size);
 
 void dbg_hit_on(bool b);
 void dbg_hit_on(bool c, bool b);
@@ -103,7 +109,8 @@ public:
 /// logical processor group. This usually means to be limited to use max 64
 /// cores. To overcome this, some special platform specific API should be
 /// called to set group affinity for each thread. Original code from Texel by
-/// Peter Österlund.
+/// Peter Österlund. Under Linux threads are pinned to logical processors
+/// following the "Thread Binding" policy.
 
 namespace WinProcGroup {
   void bindThisThread(size_t idx);
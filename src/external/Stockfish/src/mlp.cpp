@@ -0,0 +1,315 @@
+#include "mlp.h"
+#include <algorithm>
+#include <cmath>
+#include <dlib/serialize.h>
+#include <random>
+#include <sstream>
+
+namespace {
+
+const std::string MLP_MAGIC = "poscomp-mlp";
+const int MLP_VERSION = 1;
+
+// affine() computes output = input * weights + biases. With a compile time
+// number of outputs the accumulators live in registers and the inner loop is
+// fully unrolled and vectorized.
+template <unsigned Out>
+void affine(const MLP::Layer &l, const float *input, float *output) {
+  float acc[Out];
+
+  for (unsigned o = 0; o < Out; ++o)
+    acc[o] = l.biases[o];
+
+  const float *w = l.weights.data();
+
+  for (unsigned i = 0; i < l.inputs; ++i, w += Out) {
+    const float x = input[i];
+
+    for (unsigned o = 0; o < Out; ++o)
+      acc[o] += x * w[o];
+  }
+
+  std::copy(acc, acc + Out, output);
+}
+
+// affine_sparse() is affine() restricted to the weight rows of the non-zero
+// inputs, the row of each input is contiguous in the input-major layout.
+template <unsigned Out>
+void affine_sparse(const MLP::Layer &l, const float *input,
+                   const unsigned *nonzero, unsigned count, float *output) {
+  float acc[Out];
+
+  for (unsigned o = 0; o < Out; ++o)
+    acc[o] = l.biases[o];
+
+  const float *weights = l.weights.data();
+  unsigned k = 0;
+
+  // Two rows per pass halve the loads and stores of the accumulators
+  for (; k + 1 < count; k += 2) {
+    const float x0 = input[nonzero[k]], x1 = input[nonzero[k + 1]];
+    const float *w0 = weights + nonzero[k] * Out;
+    const float *w1 = weights + nonzero[k + 1] * Out;
+
+    for (unsigned o = 0; o < Out; ++o)
+      acc[o] += x0 * w0[o] + x1 * w1[o];
+  }
+
+  if (k < count) {
+    const float x = input[nonzero[k]];
+    const float *w = weights + nonzero[k] * Out;
+
+    for (unsigned o = 0; o < Out; ++o)
+      acc[o] += x * w[o];
+  }
+
+  std::copy(acc, acc + Out, output);
+}
+
+void affine_sparse_generic(const MLP::Layer &l, const float *input,
+                           const unsigned *nonzero, unsigned count,
+                           float *output) {
+  std::copy(l.biases.begin(), l.biases.end(), output);
+
+  for (unsigned k = 0; k < count; ++k) {
+    const float x = input[nonzero[k]];
+    const float *w = &l.weights[nonzero[k] * l.outputs];
+
+    for (unsigned o = 0; o < l.outputs; ++o)
+      output[o] += x * w[o];
+  }
+}
+
+void affine_generic(const MLP::Layer &l, const float *input, float *output) {
+  std::copy(l.biases.begin(), l.biases.end(), output);
+
+  const float *w = l.weights.data();
+
+  for (unsigned i = 0; i < l.inputs; ++i, w += l.outputs) {
+    const float x = input[i];
+
+    for (unsigned o = 0; o < l.outputs; ++o)
+      output[o] += x * w[o];
+  }
+}
+
+void activate(MLP::Activation a, float *output, unsigned size) {
+  switch (a) {
+  case MLP::LINEAR:
+    break;
+  case MLP::HTAN:
+    for (unsigned o = 0; o < size; ++o)
+      output[o] = std::tanh(output[o]);
+    break;
+  case MLP::RELU:
+    for (unsigned o = 0; o < size; ++o)
+      output[o] = std::max(output[o], 0.0f);
+    break;
+  case MLP::SIGMOID:
+    for (unsigned o = 0; o < size; ++o)
+      output[o] = 1.0f / (1.0f + std::exp(-output[o]));
+    break;
+  }
+}
+
+} // namespace
+
+void MLP::Layer::forward(const float *input, float *output) const {
+  switch (outputs) {
+  case 1:   affine<1>(*this, input, output);   break;
+  case 8:   affine<8>(*this, input, output);   break;
+  case 16:  affine<16>(*this, input, output);  break;
+  case 32:  affine<32>(*this, input, output);  break;
+  case 64:  affine<64>(*this, input, output);  break;
+  case 128: affine<128>(*this, input, output); break;
+  case 230: affine<230>(*this, input, output); break;
+  case 256: affine<256>(*this, input, output); break;
+  default:  affine_generic(*this, input, output);
+  }
+
+  activate(activation, output, outputs);
+}
+
+void MLP::Layer::forward_sparse(const float *input, const unsigned *nonzero,
+                                unsigned count, float *output) const {
+  switch (outputs) {
+  case 1:   affine_sparse<1>(*this, input, nonzero, count, output);   break;
+  case 8:   affine_sparse<8>(*this, input, nonzero, count, output);   break;
+  case 16:  affine_sparse<16>(*this, input, nonzero, count, output);  break;
+  case 32:  affine_sparse<32>(*this, input, nonzero, count, output);  break;
+  case 64:  affine_sparse<64>(*this, input, nonzero, count, output);  break;
+  case 128: affine_sparse<128>(*this, input, nonzero, count, output); break;
+  case 230: affine_sparse<230>(*this, input, nonzero, count, output); break;
+  case 256: affine_sparse<256>(*this, input, nonzero, count, output); break;
+  default:  affine_sparse_generic(*this, input, nonzero, count, output);
+  }
+
+  activate(activation, output, outputs);
+}
+
+MLP::Network::Network(unsigned inputs, const std::string &topology,
+                      unsigned seed) {
+  std::default_random_engine generator(seed);
+  std::stringstream ss(topology);
+  std::string spec;
+
+  while (std::getline(ss, spec, ',')) {
+    size_t colon = spec.find(':');
+
+    Layer l;
+    l.inputs = layers.empty() ? inputs : layers.back().outputs;
+    l.outputs = std::stoi(spec.substr(0, colon));
+    l.activation = colon == std::string::npos
+                       ? LINEAR
+                       : activation_from_name(spec.substr(colon + 1));
+
+    if (l.outputs == 0 || l.outputs > MaxWidth)
+      throw std::invalid_argument("Invalid layer width in '" + topology + "'");
+
+    // Same uniform initialization as dlib's fc layer
+    float limit = std::sqrt(6.0f / (l.inputs + l.outputs));
+    std::uniform_real_distribution<float> d(-limit, limit);
+
+    l.weights.resize(l.inputs * l.outputs);
+    for (float &w : l.weights)
+      w = d(generator);
+
+    l.biases.assign(l.outputs, 0.0f);
+    layers.push_back(l);
+  }
+
+  if (layers.empty() || layers.back().outputs != 1)
+    throw std::invalid_argument("Last layer of '" + topology +
+                                "' must have a single output");
+}
+
+std::string MLP::Network::topology() const {
+  std::string s;
+
+  for (const Layer &l : layers)
+    s += (s.empty() ? "" : ",") + std::to_string(l.outputs) + ":" +
+         activation_name(l.activation);
+
+  return s;
+}
+
+float MLP::Network::evaluate(const float *input) const {
+  float buffer[2][MaxWidth];
+  const float *in = input;
+  float *out = buffer[0];
+
+  for (unsigned i = 0; i < layers.size(); ++i) {
+    layers[i].forward(in, out);
+    in = out;
+    out = buffer[(i + 1) % 2];
+  }
+
+  return in[0];
+}
+
+float MLP::Network::evaluate(const float *input, const unsigned *nonzero,
+                             unsigned count) const {
+  if (count > SparseDensity * inputs())
+    return evaluate(input);
+
+  float buffer[2][MaxWidth];
+  float *out = buffer[0];
+
+  layers[0].forward_sparse(input, nonzero, count, out);
+
+  for (unsigned i = 1; i < layers.size(); ++i) {
+    layers[i].forward(buffer[(i + 1) % 2], buffer[i % 2]);
+    out = buffer[i % 2];
+  }
+
+  return out[0];
+}
+
+std::string MLP::activation_name(Activation a) {
+  return a == HTAN ? "htan" : a == RELU ? "relu" : a == SIGMOID ? "sig"
+                                                                : "linear";
+}
+
+MLP::Activation MLP::activation_from_name(const std::string &name) {
+  if (name == "linear")
+    return LINEAR;
+  else if (name == "htan")
+    return HTAN;
+  else if (name == "relu")
+    return RELU;
+  else if (name == "sig")
+    return SIGMOID;
+
+  throw std::invalid_argument("Unknown activation '" + name + "'");
+}
+
+void MLP::serialize(const Network &net, std::ostream &out) {
+  dlib::serialize(MLP_MAGIC, out);
+  dlib::serialize(MLP_VERSION, out);
+  dlib::serialize((unsigned)net.layers.size(), out);
+
+  for (const Layer &l : net.layers) {
+    dlib::serialize(l.inputs, out);
+    dlib::serialize(l.outputs, out);
+    dlib::serialize((int)l.activation, out);
+    dlib::serialize(l.weights, out);
+    dlib::serialize(l.biases, out);
+  }
+}
+
+/// deserialize() reads a network written by serialize(). If the stream holds
+/// something else (e.g. a dlib network saved by an older trainer) it is
+/// rewound and false is returned.
+
+bool MLP::deserialize(Network &net, std::istream &in) {
+  std::streampos start = in.tellg();
+  std::string magic;
+
+  try {
+    dlib::deserialize(magic, in);
+  } catch (dlib::serialization_error &) {
+    magic.clear();
+  }
+
+  if (magic != MLP_MAGIC) {
+    in.clear();
+    in.seekg(start);
+    return false;
+  }
+
+  int version;
+  unsigned count;
+
+  dlib::deserialize(version, in);
+  if (version != MLP_VERSION)
+    throw dlib::serialization_error("Unsupported MLP version " +
+                                    std::to_string(version));
+
+  dlib::deserialize(count, in);
+  net.layers.resize(count);
+
+  for (Layer &l : net.layers) {
+    int activation;
+
+    dlib::deserialize(l.inputs, in);
+    dlib::deserialize(l.outputs, in);
+    dlib::deserialize(activation, in);
+    dlib::deserialize(l.weights, in);
+    dlib::deserialize(l.biases, in);
+
+    l.activation = Activation(activation);
+
+    if (l.outputs == 0 || l.outputs > MaxWidth ||
+        l.weights.size() != l.inputs * l.outputs ||
+        l.biases.size() != l.outputs)
+      throw dlib::serialization_error("Corrupted MLP layer");
+
+    if (&l != &net.layers[0] && l.inputs != (&l - 1)->outputs)
+      throw dlib::serialization_error("Mismatched MLP layer widths");
+  }
+
+  if (net.layers.empty() || net.layers.back().outputs != 1)
+    throw dlib::serialization_error("MLP must end in a single output");
+
+  return true;
+}
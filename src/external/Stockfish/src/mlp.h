@@ -0,0 +1,68 @@
+#ifndef MLP_INCLUDED
+#define MLP_INCLUDED
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// MLP is a small multilayer perceptron whose topology (layer widths and
+/// activations) is described at runtime and stored in the model file, so the
+/// same binary can run comparator nets of different sizes. Weights are kept
+/// input-major (weights[i * outputs + o]) which is also how dlib's fc layer
+/// lays out its parameters. The forward pass is reentrant and may be called
+/// concurrently from all search threads.
+
+namespace MLP {
+
+const unsigned MaxWidth = 1024;
+
+// Above this fraction of non-zero inputs the first layer is computed densely:
+// a sparse row costs about three dense ones on 81x230 and 81x32 layers.
+const float SparseDensity = 0.3f;
+
+enum Activation { LINEAR, HTAN, RELU, SIGMOID };
+
+struct Layer {
+  unsigned inputs = 0, outputs = 0;
+  Activation activation = LINEAR;
+  std::vector<float> weights;
+  std::vector<float> biases;
+
+  void forward(const float *input, float *output) const;
+
+  // Like forward() but only the 'count' inputs listed in 'nonzero' are read,
+  // all the others are known to be zero.
+  void forward_sparse(const float *input, const unsigned *nonzero,
+                      unsigned count, float *output) const;
+};
+
+class Network {
+public:
+  Network() = default;
+
+  // Builds a randomly initialized network, e.g. "230:htan,1:linear"
+  Network(unsigned inputs, const std::string &topology, unsigned seed = 42);
+
+  unsigned inputs() const { return layers.empty() ? 0 : layers[0].inputs; }
+  std::string topology() const;
+
+  // Returns the single output of the last layer
+  float evaluate(const float *input) const;
+
+  // Same result as evaluate(), given the indices of the non-zero inputs. The
+  // first layer then only accumulates the weight rows of those inputs.
+  float evaluate(const float *input, const unsigned *nonzero,
+                 unsigned count) const;
+
+  std::vector<Layer> layers;
+};
+
+std::string activation_name(Activation a);
+Activation activation_from_name(const std::string &name);
+
+void serialize(const Network &net, std::ostream &out);
+bool deserialize(Network &net, std::istream &in);
+
+} // namespace MLP
+
+#endif // #ifndef MLP_INCLUDED
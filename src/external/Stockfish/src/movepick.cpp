@@ -259,7 +259,14 @@ Move MovePicker::next_move(bool skipQuiets) {
               && move != killers[0]
               && move != killers[1]
               && move != countermove)
+          {
+              // Late quiets are mostly pruned at once, so prefetch for the
+              // next one while this one is tried
+              if (cur < endMoves)
+                  pos.prefetch_after(*cur);
+
               return move;
+          }
       }
       ++stage;
       cur = moves; // Point to beginning of bad captures
@@ -1,25 +1,192 @@
 #include "poscomp.h"
+#include <dlib/dnn.h>
 #include <fstream>
 
+// Comparators trained before the MLP model format were saved as this dlib net
+// clang-format off
+using legacy_net_type = dlib::loss_binary_log<dlib::fc<1,
+                        dlib::htan<dlib::fc<230,
+                        dlib::input<sample_type>>>>>;
+// clang-format on
+
+static const std::string BUCKETS_MAGIC = "poscomp-buckets";
+static const int BUCKETS_VERSION = 1;
+
 static bool MODEL_LOADED = false;
-static net_type NET;
+static CompModel MODEL;
+static std::vector<int> INPUT_MAP; // model input -> FeatureName, -1 if unknown
 static std::string MODEL_FILE =
     "/Users/gauravpc/Desktop/Github/CE/chess-engine/data/trained_model.dat";
 
+template <typename FcLayer>
+static MLP::Layer import_fc(const FcLayer &fc, MLP::Activation activation) {
+  MLP::Layer l;
+  const float *params = fc.get_layer_params().host();
+
+  l.outputs = fc.get_num_outputs();
+  l.inputs = fc.get_layer_params().size() / l.outputs - 1;
+  l.activation = activation;
+  l.weights.assign(params, params + l.inputs * l.outputs);
+  l.biases.assign(params + l.inputs * l.outputs,
+                  params + (l.inputs + 1) * l.outputs);
+
+  return l;
+}
+
+static void import_legacy_net(MLP::Network &net, std::istream &in) {
+  legacy_net_type legacy;
+  dlib::deserialize(legacy, in);
+
+  net.layers = {import_fc(dlib::layer<3>(legacy).layer_details(), MLP::HTAN),
+                import_fc(dlib::layer<1>(legacy).layer_details(), MLP::LINEAR)};
+}
+
+// Reads the bucket header if present, otherwise rewinds and returns false
+static bool deserialize_buckets(std::vector<int> &bounds, unsigned &count,
+                                std::istream &in) {
+  std::streampos start = in.tellg();
+  std::string magic;
+
+  try {
+    dlib::deserialize(magic, in);
+  } catch (dlib::serialization_error &) {
+    magic.clear();
+  }
+
+  if (magic != BUCKETS_MAGIC) {
+    in.clear();
+    in.seekg(start);
+    return false;
+  }
+
+  int version;
+  dlib::deserialize(version, in);
+
+  if (version != BUCKETS_VERSION)
+    throw dlib::serialization_error("Unsupported phase buckets version " +
+                                    std::to_string(version));
+
+  dlib::deserialize(bounds, in);
+  dlib::deserialize(count, in);
+
+  if (count != bounds.size() + 1)
+    throw dlib::serialization_error("Corrupted phase buckets");
+
+  return true;
+}
+
+unsigned CompModel::bucket(int phase) const {
+  if (phase < 0)
+    return bounds.size();
+
+  unsigned b = 0;
+  while (b < bounds.size() && phase > bounds[b])
+    ++b;
+
+  return b;
+}
+
+void save_model(const CompModel &model, std::ostream &out) {
+  FeatureSchema::serialize(FeatureSchema::current(), out);
+
+  if (!model.bounds.empty()) {
+    dlib::serialize(BUCKETS_MAGIC, out);
+    dlib::serialize(BUCKETS_VERSION, out);
+    dlib::serialize(model.bounds, out);
+    dlib::serialize((unsigned)model.nets.size(), out);
+  }
+
+  for (const MLP::Network &net : model.nets)
+    MLP::serialize(net, out);
+}
+
+/// load_model() reads a model and checks its feature schema against the one
+/// compiled into this binary. Inputs are matched by feature name; features the
+/// binary no longer computes are fed as zero. Models saved before the schema
+/// was embedded are accepted only if their input width is FEATURE_COUNT. Both
+/// MLP models and dlib nets from older trainers are loaded into an MLP.
+
+void load_model(std::istream &in) {
+  const FeatureSchema::Descriptor &cur = FeatureSchema::current();
+  FeatureSchema::Descriptor model;
+
+  bool has_schema = FeatureSchema::deserialize(model, in);
+  unsigned count = 1;
+
+  MODEL.bounds.clear();
+  deserialize_buckets(MODEL.bounds, count, in);
+  MODEL.nets.resize(count);
+
+  if (!MLP::deserialize(MODEL.nets[0], in))
+    import_legacy_net(MODEL.nets[0], in);
+
+  for (unsigned b = 1; b < count; ++b)
+    if (!MLP::deserialize(MODEL.nets[b], in) ||
+        MODEL.nets[b].inputs() != MODEL.nets[0].inputs())
+      throw dlib::serialization_error("Corrupted phase bucket net");
+
+  const MLP::Network &net = MODEL.nets[0];
+
+  if (!has_schema) {
+    if (net.inputs() != FEATURE_COUNT) {
+      std::cerr << "Model without feature schema has " << net.inputs()
+                << " inputs, expected " << FEATURE_COUNT << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    std::cerr << "Model has no feature schema, assuming "
+              << FeatureSchema::hex(cur.hash) << std::endl;
+    model = cur;
+  }
+
+  if (net.inputs() != model.names.size() || net.inputs() > MLP::MaxWidth) {
+    std::cerr << "Model has " << net.inputs() << " inputs but its schema has "
+              << model.names.size() << " features" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  INPUT_MAP = FeatureSchema::remap(cur.names, model.names);
+
+  if (model != cur) {
+    std::cerr << "Model feature schema " << FeatureSchema::hex(model.hash)
+              << " differs from " << FeatureSchema::hex(cur.hash)
+              << ", remapping inputs by name" << std::endl;
+
+    for (unsigned i = 0; i < INPUT_MAP.size(); ++i)
+      if (INPUT_MAP[i] < 0)
+        std::cerr << "  unknown feature fed as zero: " << model.names[i]
+                  << std::endl;
+  }
+
+  MODEL_LOADED = true;
+}
+
 float comp_value(const CompFeat &left, const CompFeat &right) {
   if (!MODEL_LOADED) {
-    std::ifstream in(MODEL_FILE);
-    dlib::deserialize(NET, in);
-    MODEL_LOADED = true;
+    std::ifstream in(MODEL_FILE, std::ios::binary);
+    load_model(in);
   }
 
-  sample_type test;
+  // Most feature differences are zero (material cancels, many king and threat
+  // terms are absent), so collect the non-zero ones for a sparse first layer.
+  float input[MLP::MaxWidth];
+  unsigned nonzero[MLP::MaxWidth];
+  unsigned count = 0;
+
+  for (unsigned i = 0; i < INPUT_MAP.size(); ++i) {
+    int f = INPUT_MAP[i];
+    input[i] = f < 0 ? 0.0f : float(left.features[f] - right.features[f]);
 
-  for (unsigned i = 0; i < FEATURE_COUNT; ++i) {
-    test(i) = float(left.features[i] - right.features[i]);
+    if (input[i] != 0.0f)
+      nonzero[count++] = i;
   }
 
-  return NET(test);
+  // Both sides of a comparison are usually at the same phase; the right one is
+  // the empty CompFeat when evaluating a single position.
+  int phase = left.phase >= 0 ? left.phase : right.phase;
+  const MLP::Network &net = MODEL.nets[MODEL.bucket(phase)];
+
+  return net.evaluate(input, nonzero, count);
 }
 
 bool CompFeat::operator>(const CompFeat &x) const {
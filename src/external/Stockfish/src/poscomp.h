@@ -1,16 +1,28 @@
 #ifndef POS_COMP_INCLUDED
 #define POS_COMP_INCLUDED
 
+#include "featschema.h"
+#include "mlp.h"
 #include "types.h"
-#include <dlib/dnn.h>
+#include <dlib/matrix.h>
 
-typedef dlib::matrix<float, FEATURE_COUNT, 1> sample_type;
+// The input dimension is taken from the feature schema of the model so that a
+// model trained against a different FeatureName layout can still be remapped.
+typedef dlib::matrix<float, 0, 1> sample_type;
 
-// clang-format off
-using net_type = dlib::loss_binary_log<dlib::fc<1,
-                 dlib::htan<dlib::fc<230,
-                 dlib::input<sample_type>>>>>;
-// clang-format on
+// A comparator model holds one MLP per game phase bucket. Bucket i covers the
+// Material game phases up to and including bounds[i], the last bucket all the
+// phases above. A model with a single net uses it at every phase.
+struct CompModel {
+  std::vector<int> bounds;
+  std::vector<MLP::Network> nets;
+
+  // Positions of unknown phase (-1) belong to the last, opening, bucket
+  unsigned bucket(int phase) const;
+};
+
+void save_model(const CompModel &model, std::ostream &out);
+void load_model(std::istream &in);
 
 float comp_value(const CompFeat &left, const CompFeat &right);
 
@@ -157,7 +157,9 @@ void Position::init() {
 
 /// Position::set() initializes the position object with the given FEN string.
 /// This function is not very robust - make sure that input FENs are correct,
-/// this is assumed to be the responsibility of the GUI.
+/// this is assumed to be the responsibility of the GUI. 'th' may be null for
+/// a position that is only replayed, never searched nor evaluated: do_move()
+/// then counts no node and prefetches no thread's tables.
 
 Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si, Thread* th) {
 /*
@@ -677,7 +679,9 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
   assert(is_ok(m));
   assert(&newSt != st);
 
-  thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+  if (thisThread)
+      thisThread->nodes.increment();
+
   Key k = st->key ^ Zobrist::side;
 
   // Copy some fields of the old state to our new StateInfo object except the
@@ -739,6 +743,10 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
           }
 
           st->pawnKey ^= Zobrist::psq[captured][capsq];
+
+          // A pawn move prefetches its pawnsTable entry below
+          if (type_of(pc) != PAWN && thisThread)
+              prefetch2(thisThread->pawnsTable[st->pawnKey]);
       }
       else
           st->nonPawnMaterial[them] -= PieceValue[MG][captured];
@@ -749,7 +757,8 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
       // Update material hash key and prefetch access to materialTable
       k ^= Zobrist::psq[captured][capsq];
       st->materialKey ^= Zobrist::psq[captured][pieceCount[captured]];
-      prefetch(thisThread->materialTable[st->materialKey]);
+      if (thisThread)
+          prefetch(thisThread->materialTable[st->materialKey]);
 
       // Update incremental scores
       st->psq -= PSQT::psq[captured][capsq];
@@ -816,7 +825,8 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
 
       // Update pawn hash key and prefetch access to pawnsTable
       st->pawnKey ^= Zobrist::psq[pc][from] ^ Zobrist::psq[pc][to];
-      prefetch2(thisThread->pawnsTable[st->pawnKey]);
+      if (thisThread)
+          prefetch2(thisThread->pawnsTable[st->pawnKey]);
 
       // Reset rule 50 draw counter
       st->rule50 = 0;
@@ -985,6 +995,33 @@ Key Position::key_after(Move m) const {
 }
 
 
+/// Position::prefetch_after() prefetches what the search reads after the given
+/// move: the transposition table cluster of the new position and, if the move
+/// changes them, its material and pawn hash table entries. Like key_after(),
+/// it doesn't recognize special moves, for them do_move() prefetches anyway.
+
+void Position::prefetch_after(Move m) const {
+
+  Square from = from_sq(m);
+  Square to = to_sq(m);
+  Piece pc = piece_on(from);
+  Piece captured = piece_on(to);
+
+  prefetch(TT.first_entry(key_after(m)));
+
+  if (captured)
+      prefetch(thisThread->materialTable[  st->materialKey
+                                         ^ Zobrist::psq[captured][pieceCount[captured] - 1]]);
+
+  if (type_of(pc) == PAWN)
+      prefetch2(thisThread->pawnsTable[  st->pawnKey ^ Zobrist::psq[pc][from] ^ Zobrist::psq[pc][to]
+                                       ^ (type_of(captured) == PAWN ? Zobrist::psq[captured][to] : 0)]);
+
+  else if (type_of(captured) == PAWN)
+      prefetch2(thisThread->pawnsTable[st->pawnKey ^ Zobrist::psq[captured][to]]);
+}
+
+
 /// Position::see_ge (Static Exchange Evaluation Greater or Equal) tests if the
 /// SEE value of move is greater or equal to the given threshold. We'll use an
 /// algorithm similar to alpha-beta pruning with a null window.
@@ -19,6 +19,8 @@
 */
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstring>   // For std::memset
@@ -67,6 +69,69 @@ namespace {
   const int skipSize[]  = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
   const int skipPhase[] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
 
+  // ABDADA mode (UCI option "ABDADA"): all the threads search the same depth
+  // and coordinate through breadcrumbs, marks left in a small shared table on
+  // the nodes near the root a thread is searching. A thread defers the moves
+  // leading to a node another thread is searching until its other moves are
+  // done, and reduces more in a node it shares with another thread.
+  bool Abdada;
+
+  struct Breadcrumb {
+    std::atomic<Thread*> thread;
+    std::atomic<Key> key;
+  };
+
+  std::array<Breadcrumb, 1024> breadcrumbs;
+  const int BreadcrumbPly = 8;
+
+  // ThreadHolding marks the node for the lifetime of its moves loop, unless
+  // another thread holds the breadcrumb, and tells if the other thread is
+  // searching the same node.
+  struct ThreadHolding {
+
+    ThreadHolding(Thread* thisThread, Key posKey, int ply) {
+
+      location = Abdada && ply < BreadcrumbPly ? &breadcrumbs[posKey & (breadcrumbs.size() - 1)]
+                                               : nullptr;
+      owning = otherThread = false;
+
+      if (location)
+      {
+          Thread* tmp = location->thread.load(std::memory_order_relaxed);
+
+          if (tmp == nullptr)
+          {
+              location->thread.store(thisThread, std::memory_order_relaxed);
+              location->key.store(posKey, std::memory_order_relaxed);
+              owning = true;
+          }
+          else if (   tmp != thisThread
+                   && location->key.load(std::memory_order_relaxed) == posKey)
+              otherThread = true;
+      }
+    }
+
+   ~ThreadHolding() {
+      if (owning)
+          location->thread.store(nullptr, std::memory_order_relaxed);
+    }
+
+    bool marked() const { return otherThread; }
+
+  private:
+    Breadcrumb* location;
+    bool otherThread, owning;
+  };
+
+  // busy() tells if another thread is searching the node of the given key
+  bool busy(const Thread* thisThread, Key key) {
+
+    const Breadcrumb& b = breadcrumbs[key & (breadcrumbs.size() - 1)];
+    Thread* tmp = b.thread.load(std::memory_order_relaxed);
+
+    return tmp && tmp != thisThread && b.key.load(std::memory_order_relaxed) == key;
+  }
+
   // Razoring and futility margin based on depth
   // razor_margin[0] is unused as long as depth >= ONE_PLY in search
   const int razor_margin[] = { 0, 570, 603, 554 };
@@ -188,19 +253,27 @@ void Search::init() {
 
 void Search::clear() {
 
-  TT.clear();
+  // A lazy clear costs nothing now but a little on every first probe of a
+  // cluster, worth it with large tables cleared before every short search.
+  Options["Lazy Clear Hash"] ? TT.lazy_clear() : TT.clear();
 
+  // Each thread clears its own tables, which first touches them from the
+  // NUMA node it is bound to
   for (Thread* th : Threads)
-  {
-      th->counterMoves.fill(MOVE_NONE);
-      th->history.fill(0);
+      th->run_custom_job([th]() {
 
-      for (auto& to : th->counterMoveHistory)
-          for (auto& h : to)
-              h.fill(0);
+          th->counterMoves.fill(MOVE_NONE);
+          th->history.fill(0);
 
-      th->counterMoveHistory[NO_PIECE][0].fill(CounterMovePruneThreshold - 1);
-  }
+          for (auto& to : th->counterMoveHistory)
+              for (auto& h : to)
+                  h.fill(0);
+
+          th->counterMoveHistory[NO_PIECE][0].fill(CounterMovePruneThreshold - 1);
+      });
+
+  for (Thread* th : Threads)
+      th->wait_for_search_finished();
 
   Threads.main()->callsCnt = 0;
   Threads.main()->previousScore = VALUE_INFINITE;
@@ -269,6 +342,8 @@ void MainThread::search() {
   }
   else
   {
+      Abdada = Options["ABDADA"] && Threads.size() > 1;
+
       for (Thread* th : Threads)
           if (th != this)
               th->start_searching();
@@ -376,7 +451,7 @@ void Thread::search() {
          && !(Limits.depth && mainThread && rootDepth / ONE_PLY > Limits.depth))
   {
       // Distribute search depths across the threads
-      if (idx)
+      if (idx && !Abdada)
       {
           int i = (idx - 1) % 20;
           if (((rootDepth / ONE_PLY + rootPos.game_ply() + skipPhase[i]) / skipSize[i]) % 2)
@@ -553,7 +628,7 @@ namespace {
     assert(!(PvNode && cutNode));
     assert(depth / ONE_PLY * ONE_PLY == depth);
 
-    Move pv[MAX_PLY+1], quietsSearched[64];
+    Move pv[MAX_PLY+1], quietsSearched[64], deferred[MAX_MOVES];
     StateInfo st;
     TTEntry* tte;
     Key posKey;
@@ -563,7 +638,7 @@ namespace {
     bool ttHit, inCheck, givesCheck, singularExtensionNode, improving;
     bool captureOrPromotion, doFullDepthSearch, moveCountPruning, skipQuiets, ttCapture;
     Piece moved_piece;
-    int moveCount, quietCount;
+    int moveCount, quietCount, deferredCount, deferredIdx;
 
     // Step 1. Initialize node
     Thread* thisThread = pos.this_thread();
@@ -818,6 +893,7 @@ moves_loop: // When in check search starts from here
     const PieceToHistory& fm2 = *(ss-4)->history;
 
     MovePicker mp(pos, ttMove, depth, ss);
+    ThreadHolding th(thisThread, posKey, ss->ply);
     value = bestValue; // Workaround a bogus 'uninitialized' warning under gcc
     improving =   ss->staticEval >= (ss-2)->staticEval
             /* || ss->staticEval == VALUE_NONE Already implicit in the previous condition */
@@ -832,10 +908,13 @@ moves_loop: // When in check search starts from here
                            &&  tte->depth() >= depth - 3 * ONE_PLY;
     skipQuiets = false;
     ttCapture = false;
+    deferredCount = deferredIdx = 0;
 
     // Step 11. Loop through moves
-    // Loop through all pseudo-legal moves until no moves remain or a beta cutoff occurs
-    while ((move = mp.next_move(skipQuiets)) != MOVE_NONE)
+    // Loop through all pseudo-legal moves until no moves remain or a beta cutoff occurs,
+    // then through the moves deferred in ABDADA mode
+    while (   (move = mp.next_move(skipQuiets)) != MOVE_NONE
+           || (deferredIdx < deferredCount && (move = deferred[deferredIdx++]) != MOVE_NONE))
     {
       assert(is_ok(move));
 
@@ -849,6 +928,18 @@ moves_loop: // When in check search starts from here
                                   thisThread->rootMoves.end(), move))
           continue;
 
+      // ABDADA: leave a move to the thread searching its node for now, unless
+      // it is the first move or the deferred moves are being searched
+      if (   Abdada
+          && moveCount
+          && !deferredIdx
+          && ss->ply + 1 < BreadcrumbPly
+          && busy(thisThread, pos.key_after(move)))
+      {
+          deferred[deferredCount++] = move;
+          continue;
+      }
+
       ss->moveCount = ++moveCount;
 
       if (rootNode && thisThread == Threads.main() && Time.elapsed() > 3000)
@@ -941,7 +1032,7 @@ moves_loop: // When in check search starts from here
       }
 
       // Speculative prefetch as early as possible
-      prefetch(TT.first_entry(pos.key_after(move)));
+      pos.prefetch_after(move);
 
       // Check for legality just before making the move
       if (!rootNode && !pos.legal(move))
@@ -968,6 +1059,10 @@ moves_loop: // When in check search starts from here
       {
           Depth r = reduction<PvNode>(improving, depth, moveCount);
 
+          // Increase reduction if another thread is searching this node
+          if (th.marked())
+              r += ONE_PLY;
+
           if (captureOrPromotion)
               r -= r ? ONE_PLY : DEPTH_ZERO;
           else
@@ -1302,7 +1397,7 @@ moves_loop: // When in check search starts from here
           continue;
 
       // Speculative prefetch as early as possible
-      prefetch(TT.first_entry(pos.key_after(move)));
+      pos.prefetch_after(move);
 
       // Check for legality just before making the move
       if (!pos.legal(move))
@@ -20,6 +20,8 @@
 
 #include <algorithm> // For std::count
 #include <cassert>
+#include <iostream>
+#include <new>
 
 #include "movegen.h"
 #include "search.h"
@@ -29,14 +31,52 @@
 
 ThreadPool Threads; // Global object
 
+namespace {
+
+  // The table is not initialized here, it is first touched by Search::clear()
+  CounterMoveHistoryStat& new_counter_move_history() {
+
+    void* mem = aligned_large_pages_alloc(sizeof(CounterMoveHistoryStat));
+
+    if (!mem)
+    {
+        std::cerr << "Failed to allocate the counter move history." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return *new (mem) CounterMoveHistoryStat;
+  }
+
+} // namespace
+
+/// Thread::operator new() and Thread::operator delete() allocate threads
+/// aligned to a cache line, which the default operator new doesn't ensure.
+
+void* Thread::operator new(size_t size) {
+
+  void* mem = aligned_malloc(CacheLineSize, size);
+
+  if (!mem)
+      throw std::bad_alloc();
+
+  return mem;
+}
+
+void Thread::operator delete(void* mem) {
+
+  aligned_free(mem);
+}
+
+
 /// Thread constructor launches the thread and then waits until it goes to sleep
 /// in idle_loop().
 
-Thread::Thread() {
+Thread::Thread() : counterMoveHistory(new_counter_move_history()) {
 
   exit = false;
   selDepth = 0;
-  nodes = tbHits = 0;
+  nodes = 0;
+  tbHits = 0;
   idx = Threads.size(); // Start from 0
 
   std::unique_lock<Mutex> lk(mutex);
@@ -55,6 +95,8 @@ Thread::~Thread() {
   sleepCondition.notify_one();
   mutex.unlock();
   nativeThread.join();
+
+  aligned_large_pages_free(&counterMoveHistory, sizeof(CounterMoveHistoryStat));
 }
 
 
@@ -90,11 +132,42 @@ void Thread::start_searching(bool resume) {
 }
 
 
+/// Thread::run_custom_job() wakes up the thread to run 'f' instead of a search,
+/// for work that must be spread like the search threads are, for instance
+/// zeroing the slice of the transposition table the thread will probe most.
+/// Completion is waited for with wait_for_search_finished().
+
+void Thread::run_custom_job(std::function<void()> f) {
+
+  {
+      std::unique_lock<Mutex> lk(mutex);
+      sleepCondition.wait(lk, [&]{ return !searching; });
+      jobFunc = std::move(f);
+      searching = true;
+  }
+  sleepCondition.notify_one();
+}
+
+
+/// Thread::bind() binds the calling thread, which must be this one, following
+/// Threads.binding. The pawn and material tables are allocated again from the
+/// bound thread, so that their first touch puts them on its NUMA node. The
+/// search tables are first touched by Search::clear(), run on every thread.
+
+void Thread::bind() {
+
+  WinProcGroup::bindThisThread(idx);
+
+  pawnsTable = Pawns::Table();
+  materialTable = Material::Table();
+}
+
+
 /// Thread::idle_loop() is where the thread is parked when it has no work to do
 
 void Thread::idle_loop() {
 
-  WinProcGroup::bindThisThread(idx);
+  bind();
 
   while (!exit)
   {
@@ -110,7 +183,15 @@ void Thread::idle_loop() {
 
       lk.unlock();
 
-      if (!exit)
+      if (exit)
+          break;
+
+      if (jobFunc)
+      {
+          jobFunc();
+          jobFunc = nullptr;
+      }
+      else
           search();
   }
 }
@@ -123,7 +204,6 @@ void Thread::idle_loop() {
 
 void ThreadPool::init() {
 
-  push_back(new MainThread());
   read_uci_options();
 }
 
@@ -146,14 +226,35 @@ void ThreadPool::exit() {
 void ThreadPool::read_uci_options() {
 
   size_t requested = Options["Threads"];
+  size_t existing = size();
 
   assert(requested > 0);
 
+  const bool rebind = binding != std::string(Options["Thread Binding"]);
+  binding = std::string(Options["Thread Binding"]);
+
+  if (empty())
+      push_back(new MainThread());
+
   while (size() < requested)
       push_back(new Thread());
 
   while (size() > requested)
       delete back(), pop_back();
+
+  // New threads bind themselves, the others are bound again in place: the
+  // threads must outlive the positions set up with them, like the UCI one.
+  if (rebind)
+  {
+      for (size_t i = 0; i < std::min(existing, size()); ++i)
+      {
+          Thread* th = at(i);
+          th->run_custom_job([th]() { th->bind(); });
+      }
+
+      for (size_t i = 0; i < std::min(existing, size()); ++i)
+          at(i)->wait_for_search_finished();
+  }
 }
 
 
@@ -163,7 +264,7 @@ uint64_t ThreadPool::nodes_searched() const {
 
   uint64_t nodes = 0;
   for (Thread* th : *this)
-      nodes += th->nodes.load(std::memory_order_relaxed);
+      nodes += th->nodes.load();
   return nodes;
 }
 
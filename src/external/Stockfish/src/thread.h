@@ -23,6 +23,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -35,10 +36,41 @@
 #include "thread_win32.h"
 
 
+/// NodeCounter counts the nodes of a thread. It has a single writer at a time:
+/// its own thread during a search, or the UCI thread setting up a position
+/// between searches (positions only replayed, as by the PGN reader, are bound
+/// to no thread). So the increment is a plain relaxed load and store, with no
+/// locked instruction, and other threads read it relaxed as well. The counter
+/// is padded on both sides, so that it has a cache line of its own wherever
+/// the Thread lies: its writes on every node don't invalidate the line of the
+/// members around it, which other threads read.
+
+class NodeCounter {
+
+  static const int CacheLineSize = 64;
+
+  char padding1[CacheLineSize - sizeof(uint64_t)];
+  std::atomic<uint64_t> value;
+  char padding2[CacheLineSize - sizeof(uint64_t)];
+
+public:
+  NodeCounter& operator=(uint64_t v) { value.store(v, std::memory_order_relaxed); return *this; }
+  void increment() { value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+  uint64_t load() const { return value.load(std::memory_order_relaxed); }
+};
+
+
 /// Thread struct keeps together all the thread-related stuff. We also use
 /// per-thread pawn and material hash tables so that once we get a pointer to an
 /// entry its life time is unlimited and we don't have to care about someone
 /// changing the entry under our feet.
+///
+/// The members are grouped by use: the thread control, only used between
+/// searches, then the search state this thread reads and writes on every
+/// node, starting on a cache line of its own, then the counters other threads
+/// read, and the tables. Threads are allocated aligned to a cache line, so
+/// that the alignment holds. counterMoveHistory, 4MB, is allocated apart on
+/// large pages.
 
 class Thread {
 
@@ -46,30 +78,40 @@ class Thread {
   Mutex mutex;
   ConditionVariable sleepCondition;
   bool exit, searching;
+  std::function<void()> jobFunc;
 
 public:
+  static const int CacheLineSize = 64;
+
+  static void* operator new(size_t size);
+  static void operator delete(void* mem);
+
   Thread();
   virtual ~Thread();
   virtual void search();
+  void bind();
   void idle_loop();
   void start_searching(bool resume = false);
+  void run_custom_job(std::function<void()> f);
   void wait_for_search_finished();
   void wait(std::atomic_bool& condition);
 
-  Pawns::Table pawnsTable;
-  Material::Table materialTable;
-  Endgames endgames;
+  alignas(CacheLineSize) Position rootPos;
   size_t idx, PVIdx;
   int selDepth;
-  std::atomic<uint64_t> nodes, tbHits;
-
-  Position rootPos;
-  Search::RootMoves rootMoves;
   Depth rootDepth;
   Depth completedDepth;
+  Search::RootMoves rootMoves;
   CounterMoveStat counterMoves;
   ButterflyHistory history;
-  CounterMoveHistoryStat counterMoveHistory;
+
+  NodeCounter nodes;
+  std::atomic<uint64_t> tbHits;
+
+  Pawns::Table pawnsTable;
+  Material::Table materialTable;
+  Endgames endgames;
+  CounterMoveHistoryStat& counterMoveHistory;
 };
 
 
@@ -102,6 +144,7 @@ struct ThreadPool : public std::vector<Thread*> {
   uint64_t tb_hits() const;
 
   std::atomic_bool stop, stopOnPonderhit;
+  std::string binding; // "Thread Binding" policy, see WinProcGroup::bindThisThread()
 
 private:
   StateListPtr setupStates;
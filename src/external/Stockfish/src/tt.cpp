@@ -18,49 +18,307 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>   // For std::memset
+#include <fstream>
 #include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
 
 #include "bitboard.h"
+#include "thread.h"
 #include "tt.h"
 
 TranspositionTable TT; // Our global transposition table
 
+namespace {
+
+  // A snapshot is this header followed by the clusters, as they are in memory,
+  // and so is a shared table. The header is a cache line, so the clusters in
+  // the mapping stay aligned.
+  struct SnapshotHeader {
+    char     magic[8];
+    uint32_t version;
+    uint8_t  keyBytes, entryBytes, clusterSize, clusterBytes;
+    uint64_t clusterCount;
+    uint16_t epoch16;
+    uint8_t  generation8;
+    uint8_t  padding[37];
+  };
+
+  static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader size incorrect");
+
+  const char SnapshotMagic[8] = { 'S', 'F', 'T', 'T', 'S', 'N', 'A', 'P' };
+  const char SharedMagic[8]   = { 'S', 'F', 'T', 'T', 'S', 'H', 'R', 'D' };
+  const uint32_t SnapshotVersion = 1;
+
+  // The magic of a shared header while the process that claimed the object
+  // writes the rest of it. It is no magic of any layout.
+  const uint64_t ClaimedMagic = 1;
+
+  // layout_header() returns a header describing a table of 'clusterCount'
+  // clusters of the given layout, with a zero epoch and generation.
+  template<typename Layout, typename Entry, typename Cluster>
+  SnapshotHeader layout_header(const char* magic, uint64_t clusterCount) {
+
+    SnapshotHeader header = {};
+
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version      = SnapshotVersion;
+    header.keyBytes     = uint8_t(sizeof(typename Layout::KeyType));
+    header.entryBytes   = uint8_t(sizeof(Entry));
+    header.clusterSize  = uint8_t(Layout::ClusterSize);
+    header.clusterBytes = uint8_t(sizeof(Cluster));
+    header.clusterCount = clusterCount;
+    return header;
+  }
+
+  // map_file() maps a whole file read only and returns its address and size,
+  // or nullptr if it cannot be opened or mapped.
+  const char* map_file(const std::string& fname, size_t* size, uint64_t* mapping) {
+
+#ifndef _WIN32
+    struct stat statbuf;
+    int fd = ::open(fname.c_str(), O_RDONLY);
+
+    if (fd == -1)
+        return nullptr;
+
+    fstat(fd, &statbuf);
+    *size = *mapping = statbuf.st_size;
+    void* baseAddress = *size ? mmap(nullptr, *size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+
+    if (baseAddress == MAP_FAILED)
+        return nullptr;
+
+#ifdef MADV_SEQUENTIAL
+    madvise(baseAddress, *size, MADV_SEQUENTIAL);
+#endif
+#else
+    HANDLE fd = CreateFile(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (fd == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    DWORD size_high;
+    DWORD size_low = GetFileSize(fd, &size_high);
+    HANDLE mmap = CreateFileMapping(fd, nullptr, PAGE_READONLY, size_high, size_low, nullptr);
+    CloseHandle(fd);
+
+    if (!mmap)
+        return nullptr;
+
+    *size = (uint64_t(size_high) << 32) | size_low;
+    *mapping = (uint64_t)mmap;
+    void* baseAddress = MapViewOfFile(mmap, FILE_MAP_READ, 0, 0, 0);
+
+    if (!baseAddress)
+    {
+        CloseHandle(mmap);
+        return nullptr;
+    }
+#endif
+    return (const char*)baseAddress;
+  }
+
+  void unmap_file(const char* baseAddress, uint64_t mapping) {
+
+#ifndef _WIN32
+    munmap((void*)baseAddress, mapping);
+#else
+    UnmapViewOfFile(baseAddress);
+    CloseHandle((HANDLE)mapping);
+#endif
+  }
+
+} // namespace
+
 
 /// TranspositionTable::resize() sets the size of the transposition table,
 /// measured in megabytes. Transposition table consists of a power of 2 number
 /// of clusters and each cluster consists of ClusterSize number of TTEntry.
+/// The memory comes from aligned_large_pages_alloc(), so it is backed by huge
+/// pages when possible and aligned to a cache line in any case.
 
-void TranspositionTable::resize(size_t mbSize) {
+template<typename Layout>
+void TranspositionTableT<Layout>::resize(size_t mbSize) {
 
   size_t newClusterCount = size_t(1) << msb((mbSize * 1024 * 1024) / sizeof(Cluster));
 
   if (newClusterCount == clusterCount)
       return;
 
+  free_table();
+
   clusterCount = newClusterCount;
 
-  free(mem);
-  mem = calloc(clusterCount * sizeof(Cluster) + CacheLineSize - 1, 1);
+  if (!shmName.empty())
+  {
+      const size_t size = sizeof(SnapshotHeader) + clusterCount * sizeof(Cluster);
+      const SnapshotHeader expected = layout_header<Layout, Entry, Cluster>(SharedMagic, clusterCount);
+      char* mem = (char*)shared_memory_attach(shmName, size);
+
+      if (mem)
+      {
+          // A new object is zeroed. The first process to attach claims it by
+          // its magic, writes the rest of the header and then publishes the
+          // magic, so the others never compare a header being written. A lock
+          // free atomic is address free, the mapping of each process will do.
+          static_assert(sizeof(std::atomic<uint64_t>) == sizeof(expected.magic), "Magic is not an atomic word");
+
+          std::atomic<uint64_t>* magic = reinterpret_cast<std::atomic<uint64_t>*>(mem);
+          uint64_t expectedMagic, none = 0;
+          std::memcpy(&expectedMagic, expected.magic, sizeof(expectedMagic));
+
+          if (magic->compare_exchange_strong(none, ClaimedMagic, std::memory_order_acquire))
+          {
+              std::memcpy(mem + sizeof(expected.magic), (const char*)&expected + sizeof(expected.magic),
+                          sizeof(expected) - sizeof(expected.magic));
+              magic->store(expectedMagic, std::memory_order_release);
+          }
+
+          // Wait a little for a header another process is writing
+          for (int i = 0; i < 1000 && magic->load(std::memory_order_acquire) == ClaimedMagic; ++i)
+              std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
-  if (!mem)
+          if (   magic->load(std::memory_order_acquire) == expectedMagic
+              && !std::memcmp(mem, &expected, sizeof(expected)))
+              table = (Cluster*)(mem + sizeof(SnapshotHeader));
+          else
+              shared_memory_detach(mem, size);
+      }
+
+      shared = table != nullptr;
+
+      if (!shared)
+          std::cerr << "Cannot attach to shared memory " << shmName
+                    << " with this entry layout and Hash size,"
+                    << " using a private transposition table." << std::endl;
+  }
+
+  if (!table)
+      table = (Cluster*)aligned_large_pages_alloc(clusterCount * sizeof(Cluster));
+
+  if (!table)
   {
       std::cerr << "Failed to allocate " << mbSize
                 << "MB for transposition table." << std::endl;
       exit(EXIT_FAILURE);
   }
 
-  table = (Cluster*)((uintptr_t(mem) + CacheLineSize - 1) & ~(CacheLineSize - 1));
+#ifdef TT_STATS
+  fullKeys.assign(clusterCount * ClusterSize, 0);
+#endif
+
+  clear();
+}
+
+
+/// TranspositionTable::share() backs the table with the shared memory object
+/// 'name', shared with every engine process using the same name and Hash
+/// size, or with private memory again if 'name' is empty. Entries are saved
+/// and probed without locks by all the processes, as by the threads of one.
+/// The object starts with a header like a snapshot's: a process built with
+/// another entry layout does not attach and keeps a private table.
+
+template<typename Layout>
+void TranspositionTableT<Layout>::share(const std::string& name, size_t mbSize) {
+
+  if (name == shmName)
+      return;
+
+  free_table();
+  shmName = name;
+  resize(mbSize);
+}
+
+
+/// TranspositionTable::free_table() releases the memory of the table.
+
+template<typename Layout>
+void TranspositionTableT<Layout>::free_table() {
+
+  if (shared)
+      shared_memory_detach((char*)table - sizeof(SnapshotHeader),
+                           sizeof(SnapshotHeader) + clusterCount * sizeof(Cluster));
+  else
+      aligned_large_pages_free(table, clusterCount * sizeof(Cluster));
+
+  table = nullptr;
+  clusterCount = 0;
+  shared = false;
 }
 
 
 /// TranspositionTable::clear() overwrites the entire transposition table
 /// with zeros. It is called whenever the table is resized, or when the
 /// user asks the program to clear the table (from the UCI interface).
+/// The table is zeroed in slices, each by the search thread of the same index:
+/// it takes a fraction of the time of a single memset and, on a fresh table,
+/// it is the first touch of the pages, so with a first-touch NUMA policy they
+/// end up spread over the nodes of the threads that will probe them.
+/// A shared table is never cleared, its entries belong to other processes
+/// too: a new shared memory object is already zeroed.
 
-void TranspositionTable::clear() {
+template<typename Layout>
+void TranspositionTableT<Layout>::clear() {
 
-  std::memset(table, 0, clusterCount * sizeof(Cluster));
+  epoch16 = 0;
+
+  if (shared)
+      return;
+
+  // Before the thread pool exists (at startup) there is a single thread
+  if (Threads.empty())
+  {
+      std::memset(table, 0, clusterCount * sizeof(Cluster));
+      return;
+  }
+
+  const size_t threadCount = Threads.size();
+
+  for (Thread* th : Threads)
+      th->run_custom_job([this, th, threadCount]() {
+
+          const size_t stride = clusterCount / threadCount,
+                       start  = stride * th->idx,
+                       len    = th->idx != threadCount - 1 ? stride
+                                                           : clusterCount - start;
+
+          std::memset(&table[start], 0, len * sizeof(Cluster));
+      });
+
+  for (Thread* th : Threads)
+      th->wait_for_search_finished();
+}
+
+
+/// TranspositionTable::lazy_clear() empties the table without touching it: the
+/// table's epoch is bumped, so that every cluster is stale and gets emptied
+/// by the first probe() reaching it. Every 65536th call, when the epoch wraps,
+/// is a real clear(). The epoch of a shared table stays 0 in every process.
+
+template<typename Layout>
+void TranspositionTableT<Layout>::lazy_clear() {
+
+  if (!shared && ++epoch16 == 0)
+      clear();
+
+  new_search(); // Reads hashfull 0 until the table fills again
 }
 
 
@@ -71,22 +329,49 @@ void TranspositionTable::clear() {
 /// minus 8 times its relative age. TTEntry t1 is considered more valuable than
 /// TTEntry t2 if its replace value is greater than that of t2.
 
-TTEntry* TranspositionTable::probe(const Key key, bool& found) const {
+template<typename Layout>
+typename TranspositionTableT<Layout>::Entry*
+TranspositionTableT<Layout>::probe(const Key key, bool& found) const {
 
-  TTEntry* const tte = first_entry(key);
-  const uint16_t key16 = key >> 48;  // Use the high 16 bits as key inside the cluster
+  Cluster* const cl = &table[(size_t)key & (clusterCount - 1)];
+  Entry* const tte = &cl->entry[0];
+  const auto keyBits = Entry::key_bits(key); // The high bits are the key inside the cluster
+
+  // Empty a cluster left from before a lazy_clear()
+  if (cl->epoch16 != epoch16)
+  {
+      std::memset(tte, 0, sizeof(cl->entry));
+      cl->epoch16 = epoch16;
+  }
+
+#ifdef TT_STATS
+  ++probes;
+
+  auto record = [&](Entry* e, bool hit) {
+      Key& full = fullKeys[(cl - table) * ClusterSize + (e - tte)];
+      // The side key is stale if the entry was returned for a position but
+      // never saved: that hit is not counted either way.
+      hits += hit;
+      falseHits += hit && full != key && Entry::key_bits(full) == e->key;
+      full = key; // The caller saves the entry for this position
+      return e;
+  };
+#else
+  auto record = [](Entry* e, bool) { return e; };
+#endif
 
   for (int i = 0; i < ClusterSize; ++i)
-      if (!tte[i].key16 || tte[i].key16 == key16)
+      if (!tte[i].key || tte[i].key == keyBits)
       {
-          if ((tte[i].genBound8 & 0xFC) != generation8 && tte[i].key16)
+          if ((tte[i].genBound8 & 0xFC) != generation8 && tte[i].key)
               tte[i].genBound8 = uint8_t(generation8 | tte[i].bound()); // Refresh
 
-          return found = (bool)tte[i].key16, &tte[i];
+          found = (bool)tte[i].key;
+          return record(&tte[i], found);
       }
 
   // Find an entry to be replaced according to the replacement strategy
-  TTEntry* replace = tte;
+  Entry* replace = tte;
   for (int i = 1; i < ClusterSize; ++i)
       // Due to our packed storage format for generation and its cyclic
       // nature we add 259 (256 is the modulus plus 3 to keep the lowest
@@ -96,22 +381,132 @@ TTEntry* TranspositionTable::probe(const Key key, bool& found) const {
           >   tte[i].depth8 - ((259 + generation8 -   tte[i].genBound8) & 0xFC) * 2)
           replace = &tte[i];
 
-  return found = false, replace;
+  return found = false, record(replace, false);
 }
 
 
 /// TranspositionTable::hashfull() returns an approximation of the hashtable
 /// occupation during a search. The hash is x permill full, as per UCI protocol.
 
-int TranspositionTable::hashfull() const {
+template<typename Layout>
+int TranspositionTableT<Layout>::hashfull() const {
 
   int cnt = 0;
   for (int i = 0; i < 1000 / ClusterSize; i++)
   {
-      const TTEntry* tte = &table[i].entry[0];
+      if (table[i].epoch16 != epoch16)
+          continue;
+
+      const Entry* tte = &table[i].entry[0];
       for (int j = 0; j < ClusterSize; j++)
           if ((tte[j].genBound8 & 0xFC) == generation8)
               cnt++;
   }
   return cnt;
 }
+
+
+/// TranspositionTable::save_snapshot() writes the table to a file: a header
+/// describing the entry layout, the number of clusters and the generation,
+/// then the clusters themselves. Returns false if the file cannot be written.
+
+template<typename Layout>
+bool TranspositionTableT<Layout>::save_snapshot(const std::string& fname) const {
+
+  SnapshotHeader header = layout_header<Layout, Entry, Cluster>(SnapshotMagic, clusterCount);
+
+  header.epoch16      = epoch16;
+  header.generation8  = generation8;
+
+  std::ofstream file(fname, std::ios::binary);
+
+  file.write((const char*)&header, sizeof(header));
+  file.write((const char*)table, clusterCount * sizeof(Cluster));
+
+  return bool(file);
+}
+
+
+/// TranspositionTable::load_snapshot() maps a file written by save_snapshot()
+/// and copies it into the table. The snapshot must have the same entry layout
+/// and the same number of clusters as the table, i.e. it must have been saved
+/// with the same Hash option: on any mismatch the table is left untouched and
+/// the reason is written to 'err'.
+
+template<typename Layout>
+bool TranspositionTableT<Layout>::load_snapshot(const std::string& fname, std::string& err) {
+
+  size_t size;
+  uint64_t mapping;
+  const char* data = map_file(fname, &size, &mapping);
+
+  err.clear();
+
+  if (!data)
+  {
+      err = "cannot map " + fname;
+      return false;
+  }
+
+  SnapshotHeader header;
+
+  if (size >= sizeof(header))
+      std::memcpy(&header, data, sizeof(header));
+
+  if (   size < sizeof(header)
+      || std::memcmp(header.magic, SnapshotMagic, sizeof(SnapshotMagic))
+      || header.version != SnapshotVersion)
+      err = fname + " is not a hash snapshot";
+
+  else if (   header.keyBytes     != sizeof(typename Layout::KeyType)
+           || header.entryBytes   != sizeof(Entry)
+           || header.clusterSize  != ClusterSize
+           || header.clusterBytes != sizeof(Cluster))
+      err = "snapshot entry layout differs from this build's";
+
+  else if (shared)
+      err = "the table is shared with other processes";
+
+  else if (header.clusterCount != clusterCount)
+      err =  "snapshot needs Hash " + std::to_string(header.clusterCount * sizeof(Cluster) >> 20)
+           + ", the table has " + std::to_string(clusterCount * sizeof(Cluster) >> 20);
+
+  else if (size != sizeof(header) + clusterCount * sizeof(Cluster))
+      err = fname + " is truncated";
+
+  else
+  {
+      std::memcpy(table, data + sizeof(header), clusterCount * sizeof(Cluster));
+      epoch16     = header.epoch16;
+      generation8 = header.generation8;
+  }
+
+  unmap_file(data, mapping);
+  return err.empty();
+}
+
+
+#ifdef TT_STATS
+
+template<typename Layout>
+void TranspositionTableT<Layout>::reset_stats() {
+
+  probes = hits = falseHits = 0;
+}
+
+template<typename Layout>
+void TranspositionTableT<Layout>::print_stats(std::ostream& os) const {
+
+  os << "TT layout       : " << ClusterSize << " x " << 8 * sizeof(typename Layout::KeyType)
+     << " bit keys in " << sizeof(Cluster) << " bytes"
+     << "\nTT probes       : " << probes
+     << "\nTT hit rate     : " << 100.0 * hits / std::max(uint64_t(probes), uint64_t(1)) << "%"
+     << "\nTT false hits   : " << falseHits << " (" << 1e6 * falseHits / std::max(uint64_t(probes), uint64_t(1))
+     << " per million probes)" << std::endl;
+}
+
+#endif
+
+template class TranspositionTableT<TTCompact>;
+template class TranspositionTableT<TTWide>;
+template class TranspositionTableT<TTWideKey32>;
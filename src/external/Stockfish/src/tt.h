@@ -21,20 +21,33 @@
 #ifndef TT_H_INCLUDED
 #define TT_H_INCLUDED
 
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
+
 #include "misc.h"
 #include "types.h"
 
-/// TTEntry struct is the 10 bytes transposition table entry, defined as below:
+/// TTEntry struct is the transposition table entry, 10 bytes with a 16 bit key
+/// (12 with a 32 bit one), defined as below:
 ///
-/// key        16 bit
+/// key        16 or 32 bit
 /// move       16 bit
 /// value      16 bit
 /// eval value 16 bit
 /// generation  6 bit
 /// bound type  2 bit
 /// depth       8 bit
+///
+/// The key holds the highest order bits of the position key, the lowest order
+/// ones select the cluster. More key bits mean fewer false hits, positions
+/// taken for another one sharing their cluster and key bits.
+
+template<typename Layout> class TranspositionTableT;
 
-struct TTEntry {
+template<typename KeyType>
+struct TTEntryT {
 
   Move  move()  const { return (Move )move16; }
   Value value() const { return (Value)value16; }
@@ -42,21 +55,23 @@ struct TTEntry {
   Depth depth() const { return (Depth)(depth8 * int(ONE_PLY)); }
   Bound bound() const { return (Bound)(genBound8 & 0x3); }
 
+  static KeyType key_bits(Key k) { return KeyType(k >> (64 - 8 * sizeof(KeyType))); }
+
   void save(Key k, Value v, Bound b, Depth d, Move m, Value ev, uint8_t g) {
 
     assert(d / ONE_PLY * ONE_PLY == d);
 
     // Preserve any existing move for the same position
-    if (m || (k >> 48) != key16)
+    if (m || key_bits(k) != key)
         move16 = (uint16_t)m;
 
     // Don't overwrite more valuable entries
-    if (  (k >> 48) != key16
+    if (  key_bits(k) != key
         || d / ONE_PLY > depth8 - 4
      /* || g != (genBound8 & 0xFC) // Matching non-zero keys are already refreshed by probe() */
         || b == BOUND_EXACT)
     {
-        key16     = (uint16_t)(k >> 48);
+        key       = key_bits(k);
         value16   = (int16_t)v;
         eval16    = (int16_t)ev;
         genBound8 = (uint8_t)(g | b);
@@ -65,9 +80,9 @@ struct TTEntry {
   }
 
 private:
-  friend class TranspositionTable;
+  template<typename Layout> friend class TranspositionTableT;
 
-  uint16_t key16;
+  KeyType  key;
   uint16_t move16;
   int16_t  value16;
   int16_t  eval16;
@@ -76,6 +91,29 @@ private:
 };
 
 
+/// TTLayout describes a cluster: the type of the key kept in every entry, the
+/// number of entries and the size in bytes, a divisor of the cache line size.
+/// Besides its entries a cluster holds a 16 bit epoch, see lazy_clear().
+///
+///   TTCompact    3 entries, 16 bit keys, 32 bytes: two clusters a cache line
+///   TTWide       6 entries, 16 bit keys, 64 bytes: a cluster a cache line
+///   TTWideKey32  5 entries, 32 bit keys, 64 bytes: far fewer false hits
+///
+/// The engine uses TTCompact unless built with TT_LAYOUT_WIDE or
+/// TT_LAYOUT_KEY32 defined.
+
+template<typename KeyT, int Entries, int Bytes>
+struct TTLayout {
+  typedef KeyT KeyType;
+  static const int ClusterSize  = Entries;
+  static const int ClusterBytes = Bytes;
+};
+
+typedef TTLayout<uint16_t, 3, 32> TTCompact;
+typedef TTLayout<uint16_t, 6, 64> TTWide;
+typedef TTLayout<uint32_t, 5, 64> TTWideKey32;
+
+
 /// A TranspositionTable consists of a power of 2 number of clusters and each
 /// cluster consists of ClusterSize number of TTEntry. Each non-empty entry
 /// contains information of exactly one position. The size of a cluster should
@@ -83,39 +121,73 @@ private:
 /// cache lines. This ensures best cache performance, as the cacheline is
 /// prefetched, as soon as possible.
 
-class TranspositionTable {
+template<typename Layout>
+class TranspositionTableT {
+
+  typedef TTEntryT<typename Layout::KeyType> Entry;
 
   static const int CacheLineSize = 64;
-  static const int ClusterSize = 3;
+  static const int ClusterSize = Layout::ClusterSize;
 
-  struct Cluster {
-    TTEntry entry[ClusterSize];
-    char padding[2]; // Align to a divisor of the cache line size
+  struct alignas(Layout::ClusterBytes) Cluster {
+    Entry entry[ClusterSize];
+    uint16_t epoch16; // Entries are empty unless it matches the table's epoch
   };
 
+  static_assert(sizeof(Cluster) == Layout::ClusterBytes, "Cluster size incorrect");
   static_assert(CacheLineSize % sizeof(Cluster) == 0, "Cluster size incorrect");
 
 public:
- ~TranspositionTable() { free(mem); }
+ ~TranspositionTableT() { free_table(); }
   void new_search() { generation8 += 4; } // Lower 2 bits are used by Bound
   uint8_t generation() const { return generation8; }
-  TTEntry* probe(const Key key, bool& found) const;
+  Entry* probe(const Key key, bool& found) const;
   int hashfull() const;
   void resize(size_t mbSize);
+  void share(const std::string& name, size_t mbSize);
   void clear();
+  void lazy_clear();
+  bool save_snapshot(const std::string& fname) const;
+  bool load_snapshot(const std::string& fname, std::string& err);
 
   // The lowest order bits of the key are used to get the index of the cluster
-  TTEntry* first_entry(const Key key) const {
+  Entry* first_entry(const Key key) const {
     return &table[(size_t)key & (clusterCount - 1)].entry[0];
   }
 
+#ifdef TT_STATS
+  // Probes, hits and false hits, the hits on an entry saved for another
+  // position. Counting needs the full key of every entry, kept on the side.
+  void reset_stats();
+  void print_stats(std::ostream& os) const;
+
+private:
+  mutable std::atomic<uint64_t> probes, hits, falseHits;
+  mutable std::vector<Key> fullKeys;
+#endif
+
 private:
+  void free_table();
+
   size_t clusterCount;
   Cluster* table;
-  void* mem;
+  bool shared;
+  std::string shmName;
+  uint16_t epoch16;
   uint8_t generation8; // Size must be not bigger than TTEntry::genBound8
 };
 
+#if defined(TT_LAYOUT_KEY32)
+typedef TTWideKey32 TTDefaultLayout;
+#elif defined(TT_LAYOUT_WIDE)
+typedef TTWide TTDefaultLayout;
+#else
+typedef TTCompact TTDefaultLayout;
+#endif
+
+typedef TTEntryT<TTDefaultLayout::KeyType> TTEntry;
+typedef TranspositionTableT<TTDefaultLayout> TranspositionTable;
+
 extern TranspositionTable TT;
 
 #endif // #ifndef TT_H_INCLUDED
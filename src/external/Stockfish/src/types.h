@@ -322,6 +322,7 @@ struct CompFeat {
   bool pos_inf = false;
   bool neg_inf = false;
   int mate_depth = 1000000;
+  int phase = -1; // Material game phase, -1 if unknown
 
   void reset() {
     for (unsigned f = 0; f < FEATURE_COUNT; ++f) {
@@ -330,13 +331,17 @@ struct CompFeat {
 
     pos_inf = neg_inf = false;
     mate_depth = 1000000;
+    phase = -1;
   }
 
   CompFeat() {
     reset();
   }
 
-  CompFeat(ValueFeat &white_features, ValueFeat &black_features) {
+  CompFeat(ValueFeat &white_features, ValueFeat &black_features,
+           int game_phase = -1) {
+    phase = game_phase;
+
     for (unsigned f = 0; f < FEATURE_COUNT; ++f) {
       features[f] = white_features.total_counts[f] -
                     black_features.total_counts[f];
@@ -376,6 +381,8 @@ struct CompFeat {
       minus_x.features[i] = -features[i];
     }
 
+    minus_x.phase = phase;
+
     return minus_x;
   }
 
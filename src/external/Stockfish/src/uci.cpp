@@ -18,6 +18,7 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <iomanip>
@@ -151,6 +152,112 @@ namespace {
     for (unsigned f = 0; f < FEATURE_COUNT; ++f) {
       sync_cout << std::setw(6) << features.features[f] << sync_endl;
     }
+
+    sync_cout << "phase " << features.phase << sync_endl;
+    sync_cout << "key " << pos.key() << sync_endl;
+  }
+
+  // multipv_search() runs a search to 'depth' with the given MultiPV and
+  // returns the root moves, the first 'multiPV' of them sorted by score. The
+  // MultiPV option is restored afterwards.
+
+  const Search::RootMoves& multipv_search(Position& pos, int depth, int multiPV) {
+
+    Search::LimitsType limits;
+    int saved = Options["MultiPV"];
+
+    limits.startTime = now();
+    limits.depth = depth;
+    Options["MultiPV"] = std::to_string(multiPV);
+
+    Threads.start_thinking(pos, States, limits);
+    Threads.main()->wait_for_search_finished();
+
+    Options["MultiPV"] = std::to_string(saved);
+    return Threads.main()->rootMoves;
+  }
+
+  // print_screen() prints cheap signals of how informative the position is
+  // as a training sample: the number of legal moves, of checkers, whether the
+  // last move was a capture and the score gap between the two best moves of a
+  // shallow MultiPV search (VALUE_INFINITE with a single legal move).
+
+  void print_screen(Position& pos, istringstream& is) {
+
+    int depth = 6;
+    is >> depth;
+
+    auto moveList = MoveList<LEGAL>(pos);
+    int spread = VALUE_INFINITE;
+
+    if (moveList.size() > 1)
+    {
+        const Search::RootMoves& rootMoves = multipv_search(pos, depth, 2);
+        spread = std::min(int(rootMoves[0].score - rootMoves[1].score),
+                          int(VALUE_INFINITE));
+    }
+
+    sync_cout << "screen legal " << moveList.size()
+              << " checkers " << popcount(pos.checkers())
+              << " captured " << (pos.captured_piece() != NO_PIECE)
+              << " spread " << spread << sync_endl;
+  }
+
+  // print_ranked_moves() prints every legal move, whether it passes a static
+  // exchange check (see_ge with threshold zero) and its rank among the
+  // 'multiPV' best moves of a search to 'depth', -1 beyond them or without
+  // a search.
+
+  void print_ranked_moves(Position& pos, istringstream& is) {
+
+    int depth = 0, multiPV = 0;
+    is >> depth >> multiPV;
+
+    auto moveList = MoveList<LEGAL>(pos);
+    std::vector<Move> ranked;
+
+    if (depth > 0 && multiPV > 0 && moveList.size() > 0)
+    {
+        multiPV = std::min(multiPV, int(moveList.size()));
+
+        const Search::RootMoves& rootMoves = multipv_search(pos, depth, multiPV);
+
+        for (int i = 0; i < multiPV; ++i)
+            ranked.push_back(rootMoves[i].pv[0]);
+    }
+
+    for (Move m : moveList)
+    {
+        auto it = std::find(ranked.begin(), ranked.end(), m);
+
+        sync_cout << UCI::move(m, pos.is_chess960())
+                  << " see " << pos.see_ge(m)
+                  << " rank " << (it == ranked.end() ? -1 : int(it - ranked.begin()))
+                  << sync_endl;
+    }
+  }
+
+  // save_hash() and load_hash() write the transposition table to a file and
+  // read it back, so that an analysis can resume from a warm table. A snapshot
+  // only loads into a table of the same Hash size, and a later ucinewgame
+  // clears it as usual. Like the search threads, they do not lock the table.
+
+  void save_hash(istringstream& is) {
+
+    string fname;
+    getline(is >> std::ws, fname);
+
+    if (!TT.save_snapshot(fname))
+        sync_cout << "info string Cannot write hash to " << fname << sync_endl;
+  }
+
+  void load_hash(istringstream& is) {
+
+    string fname, err;
+    getline(is >> std::ws, fname);
+
+    if (!TT.load_snapshot(fname, err))
+        sync_cout << "info string Cannot load hash: " << err << sync_endl;
   }
 
 } // namespace
@@ -197,8 +304,12 @@ void UCI::run_command(std::string token, istringstream& is, Position& pos) {
   else if (token == "go")         go(pos, is);
   else if (token == "genmoves")   print_moves(pos);
   else if (token == "featextract") print_features(pos);
+  else if (token == "screen")     print_screen(pos, is);
+  else if (token == "rankmoves")  print_ranked_moves(pos, is);
   else if (token == "position")   position(pos, is);
   else if (token == "setoption")  setoption(is);
+  else if (token == "savehash")   save_hash(is);
+  else if (token == "loadhash")   load_hash(is);
 
   // Additional custom non-UCI commands, useful for debugging
   else if (token == "flip")       pos.flip();
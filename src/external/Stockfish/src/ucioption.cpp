@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <iostream>
 #include <ostream>
 
 #include "misc.h"
@@ -38,8 +39,29 @@ namespace UCI {
 /// 'On change' actions, triggered by an option's value change
 void on_clear_hash(const Option&) { Search::clear(); }
 void on_hash_size(const Option& o) { TT.resize(o); }
+void on_hash_shared(const Option& o) { string s = o; TT.share(s == "<empty>" ? "" : s, Options["Hash"]); }
 void on_logger(const Option& o) { start_logger(o); }
 void on_threads(const Option&) { Threads.read_uci_options(); }
+
+void on_thread_binding(const Option& o) {
+
+  string policy = o;
+
+  if (policy != "none" && policy != "compact" && policy != "spread")
+  {
+      sync_cout << "info string Unknown Thread Binding " << policy
+                << ", expected none, compact or spread" << sync_endl;
+      Options["Thread Binding"] = Threads.binding; // Back to the current policy
+      return;
+  }
+
+  if (policy != Threads.binding)
+  {
+      Threads.read_uci_options();
+      Search::clear();
+  }
+}
+
 void on_tb_path(const Option& o) { Tablebases::init(o); }
 
 
@@ -60,8 +82,12 @@ void init(OptionsMap& o) {
   o["Debug Log File"]        << Option("", on_logger);
   o["Contempt"]              << Option(0, -100, 100);
   o["Threads"]               << Option(1, 1, 512, on_threads);
+  o["ABDADA"]                << Option(false);
+  o["Thread Binding"]        << Option("none", on_thread_binding);
   o["Hash"]                  << Option(16, 1, MaxHashMB, on_hash_size);
   o["Clear Hash"]            << Option(on_clear_hash);
+  o["Lazy Clear Hash"]       << Option(false);
+  o["Shared Hash Name"]      << Option("<empty>", on_hash_shared);
   o["Ponder"]                << Option(false);
   o["MultiPV"]               << Option(1, 1, 500);
   o["Skill Level"]           << Option(20, 0, 20);
@@ -0,0 +1,36 @@
+#!/bin/bash
+# count the cache and TLB misses of bench with perf stat, for several thread
+# counts, to check the memory behaviour of the search under many threads.
+# Needs perf and a hardware PMU (most virtual machines have none).
+#
+# usage: tests/perfstat.sh [depth] [hash in MB] [thread counts...], from the
+# directory of the stockfish binary
+
+error()
+{
+  echo "perfstat testing failed on line $1"
+  exit 1
+}
+trap 'error ${LINENO}' ERR
+
+depth=${1:-12}
+hash=${2:-256}
+shift $(( $# < 2 ? $# : 2 ))
+threads=${@:-1 4 16}
+
+events=cycles,instructions,cache-references,cache-misses,L1-dcache-load-misses,LLC-load-misses,dTLB-load-misses
+
+if ! perf stat -e $events true > /dev/null 2>&1; then
+  echo "perf stat cannot count $events here"
+  exit 1
+fi
+
+echo "perfstat testing started"
+
+for t in $threads; do
+  echo "threads $t"
+  perf stat -x, -e $events ./stockfish bench $hash $t $depth 2>&1 \
+    | awk -F, '/Nodes\/second/ { print "  " $0 } NF > 3 && $1 ~ /^([0-9]+|<not)/ { printf "  %-24s %16s\n", $3, $1 }'
+done
+
+echo "perfstat testing OK"
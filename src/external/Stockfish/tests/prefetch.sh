@@ -0,0 +1,49 @@
+#!/bin/bash
+# measure what the prefetches of the search are worth: bench speed of a build
+# with them and of one with NO_PREFETCH, at several hash sizes. The best of a
+# few runs is reported, the spread between runs of a same build is the noise.
+#
+# usage: tests/prefetch.sh [depth] [runs] [hash sizes in MB...], from the Stockfish directory
+
+error()
+{
+  echo "prefetch testing failed on line $1"
+  exit 1
+}
+trap 'error ${LINENO}' ERR
+
+depth=${1:-10}
+runs=${2:-3}
+shift $(( $# < 2 ? $# : 2 ))
+sizes=${@:-16 256 1024}
+
+builddir=`mktemp -d`
+trap 'rm -rf $builddir' EXIT
+
+echo "prefetch testing started"
+
+cmake -S . -B $builddir/prefetch -DCMAKE_BUILD_TYPE=Release > /dev/null 2>&1
+cmake -S . -B $builddir/noprefetch -DCMAKE_BUILD_TYPE=Release \
+      -DCMAKE_CXX_FLAGS_RELEASE="-O3 -DNDEBUG -DNO_PREFETCH" > /dev/null 2>&1
+
+for build in prefetch noprefetch; do
+  cmake --build $builddir/$build --target stockfish -j`nproc` > /dev/null 2>&1
+done
+
+printf "%8s %12s %12s %8s\n" hash prefetch noprefetch gain
+
+for hash in $sizes; do
+  for build in prefetch noprefetch; do
+    best=0
+    for run in `seq $runs`; do
+      nps=`$builddir/$build/src/stockfish bench $hash 1 $depth 2>&1 | grep "Nodes/second    : " | awk '{print $3}'`
+      [ $nps -gt $best ] && best=$nps
+    done
+    eval nps_$build=$best
+  done
+
+  printf "%8s %12s %12s %7s%%\n" $hash $nps_prefetch $nps_noprefetch \
+         `awk "BEGIN { printf \"%.1f\", 100 * ($nps_prefetch / $nps_noprefetch - 1) }"`
+done
+
+echo "prefetch testing OK"
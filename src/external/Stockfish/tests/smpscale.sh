@@ -0,0 +1,41 @@
+#!/bin/bash
+# compare the scaling of Lazy SMP and of the ABDADA mode: for every thread
+# count, bench to a fixed depth and report the time to depth, the speed and
+# the time to depth speedup over one thread
+#
+# usage: tests/smpscale.sh [depth] [hash in MB] [thread counts...], from the
+# directory of the stockfish binary
+
+error()
+{
+  echo "smpscale testing failed on line $1"
+  exit 1
+}
+trap 'error ${LINENO}' ERR
+
+depth=${1:-13}
+hash=${2:-256}
+shift $(( $# < 2 ? $# : 2 ))
+threads=${@:-1 2 4 8 16}
+
+echo "smpscale testing started"
+
+printf "%-6s %8s %12s %12s %8s\n" mode threads "time (ms)" nps speedup
+
+for mode in lazy abdada; do
+  abdada=`[ $mode = abdada ] && echo true || echo false`
+  base=0
+
+  for t in $threads; do
+    out=`printf "setoption name ABDADA value $abdada\nbench $hash $t $depth\nquit\n" | ./stockfish 2>&1`
+
+    time=`echo "$out" | grep "Total time (ms) : " | awk '{print $5}'`
+    nps=`echo "$out" | grep "Nodes/second    : " | awk '{print $3}'`
+    [ $base -eq 0 ] && base=$time
+
+    printf "%-6s %8s %12s %12s %8s\n" $mode $t $time $nps \
+           `awk "BEGIN { printf \"%.2f\", $base / $time }"`
+  done
+done
+
+echo "smpscale testing OK"
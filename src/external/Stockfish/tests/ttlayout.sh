@@ -0,0 +1,43 @@
+#!/bin/bash
+# compare the transposition table layouts of tt.h on the bench positions
+# builds every layout with TT_STATS and reports, for each hash size, the bench
+# speed, the hit rate and the false hits (hits on an entry of another position)
+#
+# usage: tests/ttlayout.sh [depth] [hash sizes in MB...], from the Stockfish directory
+
+error()
+{
+  echo "ttlayout testing failed on line $1"
+  exit 1
+}
+trap 'error ${LINENO}' ERR
+
+depth=${1:-10}
+shift || true
+sizes=${@:-1 4 16 64}
+
+builddir=`mktemp -d`
+trap 'rm -rf $builddir' EXIT
+
+echo "ttlayout testing started"
+
+printf "%-8s %8s %10s %10s %10s %14s\n" layout hash nodes nps "hit rate" "false hits/M"
+
+for layout in compact wide key32; do
+  cmake -S . -B $builddir/$layout -DCMAKE_BUILD_TYPE=Release \
+        -DTT_LAYOUT=$layout -DTT_STATS=ON > /dev/null 2>&1
+  cmake --build $builddir/$layout --target stockfish -j`nproc` > /dev/null 2>&1
+
+  for hash in $sizes; do
+    out=`$builddir/$layout/src/stockfish bench $hash 1 $depth 2>&1`
+
+    nodes=`echo "$out" | grep "Nodes searched  : " | awk '{print $4}'`
+    nps=`echo "$out" | grep "Nodes/second    : " | awk '{print $3}'`
+    hitrate=`echo "$out" | grep "TT hit rate     : " | awk '{print $5}'`
+    falsehits=`echo "$out" | grep "TT false hits   : " | sed 's/.*(\([0-9.e+-]*\) per.*/\1/'`
+
+    printf "%-8s %8s %10s %10s %10s %14s\n" $layout $hash $nodes $nps $hitrate $falsehits
+  done
+done
+
+echo "ttlayout testing OK"
@@ -2,6 +2,9 @@
 #include "adapter.h"
 #include <algorithm>
 #include <assert.h>
+#include <cctype>
+#include <cmath>
+#include <functional>
 #include <iomanip>
 #include <sstream>
 
@@ -20,32 +23,96 @@ template <> unsigned TrainGame::sample_count<PERC, double>(double perc) {
 
 template <> void TrainGame::sample_moves<UNIFORM>(unsigned count) {
   auto winner_moves_indices = get_winner_moves_indices();
+  std::vector<unsigned> indices;
 
-  std::uniform_int_distribution<int> d(0, winner_moves_indices.size() - 1);
-  std::vector<unsigned> indices =
-      Utils::sample_indices<std::uniform_int_distribution<int>>(
-          d, winner_moves_indices.size(), count);
+  Sampling::uniform(this->rng, winner_moves_indices.size(), count, indices);
 
-  for (unsigned i = 0; i < count; ++i)
-    this->sampled_winner_moves_indices.push_back(
-        winner_moves_indices[indices[i]]);
+  for (unsigned i : indices)
+    this->sampled_winner_moves_indices.push_back(winner_moves_indices[i]);
 }
 
 template <> void TrainGame::sample_moves<NORM>(unsigned count) {
   auto winner_moves_indices = get_winner_moves_indices();
+  std::vector<unsigned> indices;
+
+  // Centered on the middle game, one standard deviation covers half the moves
+  double n = winner_moves_indices.size();
+  Sampling::normal(this->rng, n, count, (n - 1) / 2, n / 2, indices);
+
+  for (unsigned i : indices)
+    this->sampled_winner_moves_indices.push_back(winner_moves_indices[i]);
+}
+
+/// sample_moves<SCREENED>() screens the position before each of the winner's
+/// moves and keeps the 'count' with the highest priority. With a single legal
+/// move or in check there is no real choice, so such positions are dropped;
+/// after a capture the move is often a forced recapture. A small score spread
+/// between the two best moves marks a quiet choice, which is what the
+/// comparator has to learn, a large one a tactic the search sees anyway. The
+/// engine's score scale follows the comparator, so spreads are measured
+/// against the median of the game. Screening costs one shallow search per
+/// move, a branch about thirty continuations.
+
+template <> void TrainGame::sample_moves<SCREENED>(unsigned count) {
+  std::vector<std::pair<unsigned, ScreenInfo>> screened;
+  std::vector<int> spreads;
+
+  for (unsigned index : get_winner_moves_indices()) {
+    std::vector<std::string> init_moves(this->record.moves.begin(),
+                                        this->record.moves.begin() + index);
+    ScreenInfo info = Utils::screen(init_moves, this->screen_depth);
+
+    if (info.legal_moves < 2 || info.checkers)
+      continue;
+
+    screened.emplace_back(index, info);
+    spreads.push_back(std::abs(info.spread));
+  }
+
+  if (screened.empty())
+    return;
+
+  std::nth_element(spreads.begin(), spreads.begin() + spreads.size() / 2,
+                   spreads.end());
+  double median = std::max(spreads[spreads.size() / 2], 1);
+
+  std::vector<std::pair<double, unsigned>> ranked;
+
+  for (const auto &s : screened) {
+    double priority = median / (median + std::abs(s.second.spread));
+
+    if (s.second.after_capture)
+      priority /= 4;
+
+    // Ties are broken at random
+    priority += 1e-6 * Sampling::uniform01(this->rng);
+    ranked.emplace_back(priority, s.first);
+  }
+
+  count = std::min<size_t>(count, ranked.size());
+  std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                    std::greater<std::pair<double, unsigned>>());
 
-  std::normal_distribution<double> d =
-      Utils::generate_normal_distribution(winner_moves_indices.size());
-  std::vector<unsigned> indices =
-      Utils::sample_indices<std::normal_distribution<double>>(
-          d, winner_moves_indices.size(), count);
   for (unsigned i = 0; i < count; ++i)
-    this->sampled_winner_moves_indices.push_back(
-        winner_moves_indices[indices[i]]);
+    this->sampled_winner_moves_indices.push_back(ranked[i].second);
+
+  std::sort(this->sampled_winner_moves_indices.begin(),
+            this->sampled_winner_moves_indices.end());
 }
 
-std::vector<GameFeature>
-get_game_features(std::vector<std::string> init_moves) {
+MoveSampleStrategy move_strategy_from_name(const std::string &name) {
+  if (name == "uniform")
+    return UNIFORM;
+  else if (name == "norm")
+    return NORM;
+  else if (name == "screened")
+    return SCREENED;
+
+  throw std::invalid_argument("Unknown sampling strategy '" + name + "'");
+}
+
+std::vector<GameFeature> get_game_features(std::vector<std::string> init_moves,
+                                           int &phase, uint64_t &key) {
   std::vector<GameFeature> game_features;
 
   std::vector<std::string> uci_commands{Utils::uci_init_moves_cmd(init_moves),
@@ -56,6 +123,18 @@ get_game_features(std::vector<std::string> init_moves) {
     std::stringstream ss(uci_output_lines[i]);
     int val;
 
+    if (uci_output_lines[i].compare(0, 6, "phase ") == 0) {
+      std::string token;
+      ss >> token >> phase;
+      continue;
+    }
+
+    if (uci_output_lines[i].compare(0, 4, "key ") == 0) {
+      std::string token;
+      ss >> token >> key;
+      continue;
+    }
+
     ss >> val;
 
     GameFeature gf;
@@ -73,12 +152,12 @@ MoveBranch TrainGame::get_move_branch(unsigned index) {
   std::vector<std::string> init_moves;
 
   for (unsigned i = 0; i < index; ++i) {
-    mb.init_move_line.push_back(this->total_move_line[i]);
-    init_moves.push_back(this->total_move_line[i]);
+    mb.init_move_line.push_back(this->record.moves[i]);
+    init_moves.push_back(this->record.moves[i]);
   }
 
-  mb.true_continuation.push_back(this->total_move_line[index]);
-  init_moves.push_back(this->total_move_line[index]);
+  mb.true_continuation.push_back(this->record.moves[index]);
+  init_moves.push_back(this->record.moves[index]);
 
   auto extension =
       Utils::get_move_cont(init_moves, this->continuation_size, this->movetime);
@@ -86,12 +165,13 @@ MoveBranch TrainGame::get_move_branch(unsigned index) {
     mb.true_continuation.push_back(m);
 
   mb.true_continuation_features =
-      get_game_features(init_moves);
+      get_game_features(init_moves, mb.phase, mb.true_key);
 
   init_moves.pop_back();
 
-  auto alt_moves =
-      Utils::get_alt_moves(mb.init_move_line, mb.true_continuation[0]);
+  auto alt_moves = Utils::select_alt_moves(
+      mb.init_move_line, mb.true_continuation[0], this->alt_selection,
+      this->rng);
 
   for (std::string alt_move : alt_moves) {
     std::vector<std::string> alt_continuation{alt_move};
@@ -104,8 +184,11 @@ MoveBranch TrainGame::get_move_branch(unsigned index) {
       alt_continuation.push_back(m);
 
     mb.alt_continuations.push_back(alt_continuation);
+    int alt_phase;
+    uint64_t alt_key;
     mb.alt_continuations_features.push_back(
-        get_game_features(init_moves));
+        get_game_features(init_moves, alt_phase, alt_key));
+    mb.alt_keys.push_back(alt_key);
 
     init_moves.pop_back();
   }
@@ -113,60 +196,104 @@ MoveBranch TrainGame::get_move_branch(unsigned index) {
   return mb;
 }
 
-bool TrainGame::from_lines(const std::vector<std::string> lines) {
-  bool valid_game = false;
-  bool move_lines = false;
+bool GameRecord::from_pgn(const PgnGame &game, unsigned id) {
+  this->moves.clear();
 
-  this->reset();
+  if (!game.error.empty()) {
+    std::cerr << "Skipping game " << id << ": " << game.error << std::endl;
+    return false;
+  }
 
-  for (auto line : lines) {
-    if (line == "Moves") {
-      move_lines = true;
-    } else if (move_lines) {
-      std::stringstream ss(line);
-      std::string move_num, move;
-
-      ss >> move_num >> move;
-
-      this->total_move_line.push_back(move);
-    } else {
-      std::stringstream ss(line);
-      std::string key, val;
-
-      ss >> key >> val;
-
-      if (key == "GameId") {
-        this->id = std::stoi(val);
-        valid_game = true;
-      } else if (key == "PlyCount") {
-        this->ply_count = std::stoi(val);
-      } else if (key == "Result") {
-        if (val == "1-0")
-          this->result = WHITE_WON;
-        else if (val == "0-1")
-          this->result = BLACK_WON;
-        else if (val == "1/2-1/2")
-          this->result = DRAW;
-        else
-          assert(false);
-      } else if (key == "WhiteElo") {
-        this->white_elo = std::stoi(val);
-      } else if (key == "BlackElo") {
-        this->black_elo = std::stoi(val);
-      } else {
-        assert(false);
-      }
-    }
+  if (game.result == "1-0")
+    this->result = WHITE_WON;
+  else if (game.result == "0-1")
+    this->result = BLACK_WON;
+  else if (game.result == "1/2-1/2")
+    this->result = DRAW;
+  else {
+    std::cerr << "Skipping game " << id << ": no result" << std::endl;
+    return false;
+  }
+
+  std::string white_elo = game.tag("WhiteElo"), black_elo = game.tag("BlackElo");
+  std::string game_id = game.tag("GameId");
+
+  this->id = isdigit(game_id[0]) ? std::stoi(game_id) : id;
+  this->white_elo = isdigit(white_elo[0]) ? std::stoi(white_elo) : 0;
+  this->black_elo = isdigit(black_elo[0]) ? std::stoi(black_elo) : 0;
+  this->moves = game.moves;
+
+  return true;
+}
+
+void GameFilter::set_results(const std::string &results) {
+  std::stringstream ss(results);
+  std::string r;
+
+  white_wins = black_wins = draws = false;
+
+  while (std::getline(ss, r, ',')) {
+    if (r == "1-0")
+      white_wins = true;
+    else if (r == "0-1")
+      black_wins = true;
+    else if (r == "1/2-1/2")
+      draws = true;
+    else
+      throw std::invalid_argument("Unknown result '" + r + "'");
   }
+}
+
+bool GameFilter::accept(const GameRecord &game) const {
+  bool result = game.result == WHITE_WON   ? white_wins
+                : game.result == BLACK_WON ? black_wins
+                                           : draws;
+
+  return result && std::min(game.white_elo, game.black_elo) >= min_elo &&
+         game.moves.size() >= min_ply &&
+         (!max_ply || game.moves.size() <= max_ply);
+}
+
+float TrainGame::sample_weight(unsigned index) const {
+  if (!this->elo_weight_scale || !this->record.white_elo ||
+      !this->record.black_elo)
+    return 1.0f;
+
+  double diff = double(this->record.white_elo) - this->record.black_elo;
+
+  if (index % 2)
+    diff = -diff;
+
+  return 2.0 / (1.0 + std::pow(10.0, -diff / this->elo_weight_scale));
+}
+
+/// expand() checks 'cancel' before every branch, so that a stop request costs
+/// at most the searches of one branch.
+
+bool TrainGame::expand(const GameRecord &game,
+                       const std::atomic<bool> *cancel) {
+  this->reset();
+  this->record = game;
+  this->rng = PRNG(Sampling::seed(this->seed, game.id));
+
+  unsigned count = this->sample_count<PERC, double>(20.0);
 
-  assert(this->ply_count == this->total_move_line.size());
+  switch (this->move_strategy) {
+  case UNIFORM:  this->sample_moves<UNIFORM>(count);  break;
+  case NORM:     this->sample_moves<NORM>(count);     break;
+  case SCREENED: this->sample_moves<SCREENED>(count); break;
+  }
 
-  this->sample_moves<UNIFORM>(this->sample_count<PERC, double>(20.0));
+  for (unsigned index : this->sampled_winner_moves_indices) {
+    if (cancel && *cancel) {
+      this->reset();
+      return false;
+    }
 
-  for (unsigned index : this->sampled_winner_moves_indices)
     this->sampled_moves_branches.push_back(this->get_move_branch(index));
+  }
 
-  return valid_game;
+  return true;
 }
 
 std::vector<std::string> TrainGame::to_lines() {
@@ -175,29 +302,29 @@ std::vector<std::string> TrainGame::to_lines() {
 
   std::string result_str;
 
-  if (this->result == BLACK_WON)
+  if (this->record.result == BLACK_WON)
     result_str = "0-1";
-  else if (this->result == WHITE_WON)
+  else if (this->record.result == WHITE_WON)
     result_str = "1-0";
   else
     result_str = "1/2-1/2";
 
   ss << "GameId"
-     << "        " << this->id << std::endl;
+     << "        " << this->record.id << std::endl;
   ss << "Result"
      << "        " << result_str << std::endl;
   ss << "PlyCount"
-     << "        " << this->ply_count << std::endl;
+     << "        " << this->record.moves.size() << std::endl;
   ss << "WhiteElo"
-     << "        " << this->white_elo << std::endl;
+     << "        " << this->record.white_elo << std::endl;
   ss << "BlackElo"
-     << "        " << this->black_elo << std::endl;
+     << "        " << this->record.black_elo << std::endl;
 
   ss << "Moves" << std::endl;
 
-  for (unsigned i = 0; i < this->total_move_line.size(); ++i) {
+  for (unsigned i = 0; i < this->record.moves.size(); ++i) {
     ss << std::setw(3) << i + 1 << (i % 2 == 0 ? std::setw(12) : std::setw(24))
-       << this->total_move_line[i] << std::endl;
+       << this->record.moves[i] << std::endl;
   }
 
   ss << "SampledWinnerMoves" << std::endl;
@@ -206,7 +333,7 @@ std::vector<std::string> TrainGame::to_lines() {
     ss << std::setw(3) << this->sampled_winner_moves_indices[i] + 1
        << (this->sampled_winner_moves_indices[i] % 2 == 0 ? std::setw(12)
                                                           : std::setw(24))
-       << this->total_move_line[this->sampled_winner_moves_indices[i]]
+       << this->record.moves[this->sampled_winner_moves_indices[i]]
        << std::endl;
   }
 
@@ -255,13 +382,17 @@ std::vector<std::string> TrainGame::to_lines() {
   return lines;
 }
 
-std::vector<std::string> TrainGame::to_csv_lines() {
-  std::vector<std::string> csv_lines;
+std::vector<TrainSample> TrainGame::to_samples(Dedup *dedup) {
+  std::vector<TrainSample> samples;
 
   for (unsigned i = 0; i < this->sampled_winner_moves_indices.size(); ++i) {
     for (unsigned j = 0;
          j < this->sampled_moves_branches[i].alt_continuations.size(); ++j) {
-      std::stringstream ss_left, ss_right;
+      if (dedup && !dedup->insert(this->sampled_moves_branches[i].true_key,
+                                  this->sampled_moves_branches[i].alt_keys[j]))
+        continue;
+
+      TrainSample sample;
 
       for (int f = 0;
            f <
@@ -273,14 +404,35 @@ std::vector<std::string> TrainGame::to_csv_lines() {
                        this->sampled_moves_branches[i]
                            .alt_continuations_features[j][f]
                            .feature_val;
-        ss_left << left << ',';
-        ss_right << -left << ',';
+        sample.diffs.push_back(left);
       }
 
-      csv_lines.push_back(ss_left.str() + "Left");
-      csv_lines.push_back(ss_right.str() + "Right");
+      sample.phase = this->sampled_moves_branches[i].phase;
+      sample.weight = sample_weight(this->sampled_winner_moves_indices[i]);
+      samples.push_back(std::move(sample));
     }
   }
 
+  return samples;
+}
+
+std::vector<std::string> TrainGame::to_csv_lines(Dedup *dedup) {
+  std::vector<std::string> csv_lines;
+
+  for (const TrainSample &sample : to_samples(dedup)) {
+    std::stringstream ss_left, ss_right;
+
+    for (int16_t left : sample.diffs) {
+      ss_left << left << ',';
+      ss_right << -left << ',';
+    }
+
+    std::stringstream ss_meta;
+    ss_meta << sample.phase << ',' << sample.weight << ',';
+
+    csv_lines.push_back(ss_left.str() + ss_meta.str() + "Left");
+    csv_lines.push_back(ss_right.str() + ss_meta.str() + "Right");
+  }
+
   return csv_lines;
 }
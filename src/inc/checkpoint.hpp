@@ -0,0 +1,35 @@
+#ifndef CHECKPOINT_INCLUDED
+#define CHECKPOINT_INCLUDED
+
+#include <stdint.h>
+#include <string>
+
+// Checkpoint records how far a generate run got, so that an interrupted run
+// can resume. Games are consumed from the input in order: 'skip' games of the
+// chunk starting at byte 'offset' (a game boundary) were consumed, 'games' in
+// total. Output goes to shards, shard 0 being the output file itself and
+// shard n > 0 '<output>.n'; shard 'shard' held 'shard_bytes' bytes of whole
+// games when the checkpoint was written.
+struct Checkpoint {
+  std::string input;
+  uint64_t input_size = 0;
+  uint64_t offset = 0;
+  uint64_t skip = 0;
+  uint64_t games = 0;
+  unsigned last_id = 0;
+  unsigned shard = 0;
+  uint64_t shard_bytes = 0;
+
+  // save() writes a temporary file renamed over 'path', so a crash while
+  // saving leaves the previous checkpoint intact.
+  bool save(const std::string &path) const;
+  bool load(const std::string &path);
+
+  static std::string shard_path(const std::string &output, unsigned shard);
+};
+
+// Cuts a file to 'size' bytes, used to drop output written after the last
+// checkpoint of an interrupted run.
+bool truncate_file(const std::string &path, uint64_t size);
+
+#endif // #ifndef CHECKPOINT_INCLUDED
@@ -0,0 +1,110 @@
+#ifndef COLUMNAR_INCLUDED
+#define COLUMNAR_INCLUDED
+
+#include "poscomp.h"
+#include <iostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+template <typename sample_type> struct SampleSet;
+
+// Columnar dataset: the samples of a CSV dataset stored column by column in
+// blocks of up to 'rows_per_block' rows. Every column of a block (the
+// features, then Phase, Weight and Label) is encoded on its own with whichever
+// of bit packing (offset from the block minimum), zigzag varint, delta zigzag
+// varint or sparse (gaps and values of the non zero entries) is smallest, and
+// carries its minimum, maximum and count of non zero values, so readers can
+// skip the columns they do not need. Generated datasets hold every comparison
+// twice, as a Left row and its negated Right row; blocks made only of such
+// pairs store the Left rows alone.
+//
+//   header: magic, version, schema hash, feature count, feature names
+//   block:  row count, mirrored flag, one ColumnStats per column, column data
+namespace Columnar {
+
+enum Encoding : uint8_t { BITPACK, VARINT, DELTA, SPARSE };
+
+struct ColumnStats {
+  Encoding encoding = BITPACK;
+  uint8_t width = 0; // bits per value for BITPACK
+  int32_t min = 0, max = 0;
+  uint32_t nonzero = 0;
+  uint32_t bytes = 0; // encoded size of the column in this block
+};
+
+// Appends the encoding of 'values' to 'out' and returns its stats
+ColumnStats encode(const std::vector<int32_t> &values, std::string &out);
+// Decodes 'count' values encoded as described by 'stats'. Returns false if
+// the stats cannot describe 'count' values or the data does not match them.
+bool decode(const ColumnStats &stats, const char *data, size_t count,
+            std::vector<int32_t> &values);
+
+// True if the stream starts with the columnar magic (nothing is consumed)
+bool is_columnar(std::istream &in);
+
+class Writer {
+public:
+  Writer(std::ostream &out, const std::vector<std::string> &names,
+         unsigned rows_per_block = 16384);
+  ~Writer() { flush(); }
+
+  // 'features' in the order of the names given to the constructor
+  void push_back(const std::vector<int32_t> &features, int phase, float weight,
+                 float label);
+  void flush();
+
+  uint64_t rows() const { return row_count; }
+  // Columns written with each Encoding
+  const std::vector<uint64_t> &encodings() const { return encoding_count; }
+
+private:
+  bool mirrored() const;
+
+  std::ostream &out;
+  unsigned rows_per_block;
+  std::vector<std::vector<int32_t>> columns;
+  uint64_t row_count;
+  std::vector<uint64_t> encoding_count;
+};
+
+class Reader {
+public:
+  explicit Reader(std::istream &in);
+
+  bool good() const { return valid; }
+  const std::vector<std::string> &names() const { return file_names; }
+  uint64_t file_hash() const { return hash; }
+
+  // Only the listed features (of the current schema) are decoded, the others
+  // are read as zero and their data is skipped. Empty decodes all of them.
+  void project(const std::vector<std::string> &features);
+
+  // Decodes the next block into samples of the current FeatureName order,
+  // appending them to 'set'. Returns false at the end of the file, or at a
+  // corrupt or truncated block, after which good() is false.
+  bool next(SampleSet<sample_type> &set);
+
+  // Stats of every column of the last block, in file order
+  const std::vector<ColumnStats> &stats() const { return block_stats; }
+
+private:
+  std::istream &in;
+  bool valid;
+  uint64_t hash;
+  std::vector<std::string> file_names;
+  std::vector<int> column; // file column of every current feature, or -1
+  std::vector<bool> wanted; // file columns to decode
+  std::vector<ColumnStats> block_stats;
+  std::vector<std::vector<int32_t>> values;
+  std::string buffer;
+};
+
+// Converts a CSV dataset (with its schema header) to the columnar format,
+// returns the number of rows written or -1 if the input has no header.
+int64_t convert(std::istream &csv, std::ostream &out,
+                unsigned rows_per_block = 16384);
+
+} // namespace Columnar
+
+#endif // #ifndef COLUMNAR_INCLUDED
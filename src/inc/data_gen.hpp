@@ -2,19 +2,222 @@
 #define DATA_GEN_INCLUDED
 
 #include "adapter.h"
+#include "checkpoint.hpp"
+#include "featschema.h"
 #include "gameinfo.hpp"
+#include "ingest.hpp"
 #include "io.hpp"
+#include "pipeline.hpp"
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 
-void generate(std::istream &in, std::ostream &out) {
+struct GenerateOptions {
+  // Drop samples comparing a pair of positions already written: "exact" keeps
+  // a hash set of the pairs, "bloom" a fixed size Bloom filter sized for
+  // 'dedup_expected' pairs at 'dedup_fp_rate', "none" writes every sample.
+  std::string dedup = "exact";
+  size_t dedup_expected = 1 << 20;
+  double dedup_fp_rate = 0.001;
+
+  // Games are parsed on 'ingest.threads' threads in chunks of
+  // 'ingest.chunk_size' bytes while the engine expands earlier ones.
+  IngestOptions ingest;
+
+  // Games not accepted by the filter (rating, result, length) are skipped
+  // before any engine work. By default only decisive games are kept.
+  GameFilter filter;
+
+  // See TrainGame::elo_weight_scale
+  double elo_weight_scale = 400;
+
+  // See TrainGame::seed
+  uint64_t seed = 42;
+
+  // Which of the winner's moves are expanded: "uniform", "norm" or
+  // "screened" (see TrainGame::screen_depth)
+  std::string sampling = "uniform";
+  unsigned screen_depth = 6;
+
+  // Pruning of the alternatives to the played move, see AltSelection
+  AltSelection alt_selection;
+
+  // Without expansion games are only parsed and filtered, which counts a
+  // corpus at parsing speed and writes no samples.
+  bool expand = true;
+
+  // Name of a shared memory transposition table (e.g. "/pretrain-hash"),
+  // shared with the other generator processes given the same name. Empty
+  // keeps a private one. Searches then depend on the other processes.
+  std::string shared_hash;
+
+  // Raised (e.g. by a signal handler) to stop after the game being expanded,
+  // which is dropped, so the output only holds whole games.
+  const std::atomic<bool> *cancel = nullptr;
+
+  // A checkpoint '<output>.ckpt' is saved every 'checkpoint_every' written
+  // games and when the run ends. With 'resume' a run continues from it: the
+  // last shard is cut back to the checkpoint and a new shard is started.
+  // Dedup state is not saved, a resumed run only dedups within its shards.
+  bool resume = false;
+  unsigned checkpoint_every = 100;
+};
+
+/// generate() runs the pipeline parse -> filter -> expand -> write. Parsing is
+/// spread over the ingest threads; expansion runs the engine, which is a
+/// global, so it stays on this thread.
+
+void generate(const std::string &path, const std::string &output,
+              const GenerateOptions &options = GenerateOptions()) {
+  MappedFile file(path);
+
+  if (!file.is_open()) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return;
+  }
+
+  if (!options.shared_hash.empty())
+    Adapter::set_option("Shared Hash Name", options.shared_hash);
+
+  std::string checkpoint_path = output + ".ckpt";
+  IngestOptions ingest_options = options.ingest;
+  Checkpoint checkpoint;
+
+  if (options.resume && checkpoint.load(checkpoint_path)) {
+    if (checkpoint.input != path || checkpoint.input_size != file.size()) {
+      std::cerr << "Checkpoint " << checkpoint_path << " was saved for "
+                << checkpoint.input << " (" << checkpoint.input_size
+                << " bytes)" << std::endl;
+      return;
+    }
+
+    if (checkpoint.offset >= file.size()) {
+      std::cout << "Already done: " << checkpoint.games << " games"
+                << std::endl;
+      return;
+    }
+
+    truncate_file(Checkpoint::shard_path(output, checkpoint.shard),
+                  checkpoint.shard_bytes);
+
+    ++checkpoint.shard;
+    checkpoint.shard_bytes = 0;
+    ingest_options.start = checkpoint.offset;
+
+    std::cout << "Resuming after " << checkpoint.games << " games (last game "
+              << checkpoint.last_id << ")" << std::endl;
+  } else {
+    if (options.resume)
+      std::cout << "No checkpoint, starting from the first game" << std::endl;
+
+    checkpoint.input = path;
+    checkpoint.input_size = file.size();
+  }
+
+  std::ofstream out(Checkpoint::shard_path(output, checkpoint.shard),
+                    std::ios::binary);
+  Ingest ingest(file.data(), file.size(), ingest_options);
+  Dedup dedup(Dedup::mode_from_name(options.dedup), options.dedup_expected,
+              options.dedup_fp_rate);
+  Stage parse("parse"), filter("filter"), expand("expand"), write("write");
+  PgnGame pgn;
+  GameRecord record;
   TrainGame game;
 
-  unsigned count = 0;
-  while (get_game(game, in)) {
-    put_game<std::ostream>(game, out, "csv_lines");
-    std::cout << " --- processed game: " << ++count << std::endl;
+  game.elo_weight_scale = options.elo_weight_scale;
+  game.seed = options.seed;
+  game.move_strategy = move_strategy_from_name(options.sampling);
+  game.screen_depth = options.screen_depth;
+  game.alt_selection = options.alt_selection;
+
+  // Games consumed before 'ingest_options.start', then the ones to skip
+  uint64_t base = checkpoint.games - checkpoint.skip;
+  for (uint64_t i = 0; i < checkpoint.skip; ++i)
+    ingest.next(pgn);
+
+  // The checkpoint follows each written game, it is only saved from time to
+  // time since the output must be flushed first.
+  auto save_checkpoint = [&]() {
+    out.flush();
+    checkpoint.save(checkpoint_path);
+  };
+
+  if (options.expand)
+    out << FeatureSchema::csv_comment(FeatureSchema::current()) << std::endl
+        << FeatureSchema::csv_header(FeatureSchema::current()) << std::endl;
+
+  while (!(options.cancel && *options.cancel)) {
+    {
+      Stage::Timer t(parse);
+
+      if (!ingest.next(pgn))
+        break;
+
+      parse.in();
+      if (!record.from_pgn(pgn, base + ingest.games()))
+        continue;
+      parse.out();
+    }
+
+    {
+      Stage::Timer t(filter);
+
+      filter.in();
+      if (!options.filter.accept(record))
+        continue;
+      filter.out();
+    }
+
+    if (!options.expand)
+      continue;
+
+    {
+      Stage::Timer t(expand);
+
+      expand.in();
+      if (!game.expand(record, options.cancel))
+        break;
+      expand.out();
+    }
+
+    {
+      Stage::Timer t(write);
+
+      write.in();
+      put_game<std::ostream>(game, out, "csv_lines", &dedup);
+      write.out();
+    }
+
+    ingest.position(checkpoint.offset, checkpoint.skip);
+    checkpoint.games = base + ingest.games();
+    checkpoint.last_id = record.id;
+    checkpoint.shard_bytes = out.tellp();
+
+    if (options.checkpoint_every &&
+        write.items_out % options.checkpoint_every == 0)
+      save_checkpoint();
+
+    std::cout << " --- processed game: " << expand.items_out << std::endl;
   }
+
+  if (options.cancel && *options.cancel)
+    std::cout << "Stopped after " << write.items_out << " games" << std::endl;
+  else {
+    // Done: games filtered out after the last written one are consumed too
+    ingest.position(checkpoint.offset, checkpoint.skip);
+    checkpoint.games = base + ingest.games();
+    checkpoint.shard_bytes = out.tellp();
+  }
+
+  if (options.expand)
+    save_checkpoint();
+
+  std::cout << ingest.report() << std::endl
+            << report({&parse, &filter, &expand, &write}) << std::endl;
+
+  if (options.expand)
+    std::cout << dedup.report() << std::endl;
 }
 
 #endif // #ifndef DATA_GEN_INCLUDED
@@ -1,6 +1,9 @@
 #ifndef DATA_IO_INCLUDED
 #define DATA_IO_INCLUDED
 
+#include "columnar.hpp"
+#include "featschema.h"
+#include <algorithm>
 #include <dlib/matrix.h>
 #include <fstream>
 #include <iostream>
@@ -9,37 +12,181 @@
 
 using namespace dlib;
 
+inline std::vector<std::string> split_csv_line(const std::string &line) {
+  std::vector<std::string> cells;
+
+  std::stringstream ss(line);
+  std::string cell;
+
+  while (std::getline(ss, cell, ',')) {
+    cells.push_back(cell);
+  }
+
+  return cells;
+}
+
+template <typename sample_type> struct SampleSet {
+  std::vector<sample_type> samples;
+  std::vector<float> labels;
+  std::vector<int> phases;    // -1 when the dataset has no phase column
+  std::vector<float> weights; // 1 when the dataset has no weight column
+
+  void push_back(const sample_type &sample, float label, int phase,
+                 float weight = 1.0f) {
+    samples.push_back(sample);
+    labels.push_back(label);
+    phases.push_back(phase);
+    weights.push_back(weight);
+  }
+
+  size_t size() const { return samples.size(); }
+};
+
+inline bool is_ablated(const std::vector<std::string> &ablate,
+                       const std::string &name) {
+  return std::find(ablate.begin(), ablate.end(), name) != ablate.end();
+}
+
+// Samples of a columnar dataset, decoded block by block. Ablated features are
+// not decoded at all.
+template <typename sample_type>
+void load_columnar(std::istream &in, float test_perc,
+                   SampleSet<sample_type> &train, SampleSet<sample_type> &test,
+                   const std::vector<std::string> &ablate) {
+  dlib::rand rnd(42);
+
+  const FeatureSchema::Descriptor &cur = FeatureSchema::current();
+  Columnar::Reader reader(in);
+
+  if (!reader.good()) {
+    std::cerr << "Unsupported columnar dataset" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (reader.file_hash() != cur.hash)
+    std::cerr << "Dataset feature schema " << FeatureSchema::hex(reader.file_hash())
+              << " differs from " << FeatureSchema::hex(cur.hash)
+              << ", remapping columns by name" << std::endl;
+
+  std::vector<std::string> kept;
+  for (const std::string &name : cur.names)
+    if (!is_ablated(ablate, name))
+      kept.push_back(name);
+  reader.project(kept);
+
+  SampleSet<sample_type> block;
+
+  while (reader.next(block)) {
+    for (size_t i = 0; i < block.size(); ++i)
+      (rnd.get_random_32bit_number() % 100 > test_perc ? train : test)
+          .push_back(block.samples[i], block.labels[i], block.phases[i],
+                     block.weights[i]);
+
+    block = SampleSet<sample_type>();
+  }
+
+  if (!reader.good()) {
+    std::cerr << "Corrupt columnar dataset" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Samples are always built in the FeatureName order of this binary. Datasets
+// carrying a schema header are remapped by column name, headerless (legacy)
+// datasets are assumed to be in the current order without phase and weight
+// columns. Features listed in 'ablate' are read as zero.
 template <typename sample_type>
 void load_train_test(std::istream &in, float test_perc,
-                     std::vector<sample_type> &train_samples,
-                     std::vector<float> &train_labels,
-                     std::vector<sample_type> &test_samples,
-                     std::vector<float> &test_labels) {
+                     SampleSet<sample_type> &train,
+                     SampleSet<sample_type> &test,
+                     const std::vector<std::string> &ablate = {}) {
+  if (Columnar::is_columnar(in)) {
+    load_columnar(in, test_perc, train, test, ablate);
+
+    std::cout << "Training sample size: " << train.size() << std::endl
+              << "Test sample size: " << test.size() << std::endl;
+    return;
+  }
+
   dlib::rand rnd(42);
 
-  sample_type st;
-  unsigned feat_count = st.nr();
+  const FeatureSchema::Descriptor &cur = FeatureSchema::current();
+  unsigned feat_count = cur.names.size();
+
+  std::vector<int> column(feat_count);
+  for (unsigned i = 0; i < feat_count; ++i)
+    column[i] = is_ablated(ablate, cur.names[i]) ? -1 : i;
+  unsigned label_column = feat_count;
+  int phase_column = -1, weight_column = -1;
+
+  uint64_t file_hash = cur.hash;
+  bool has_comment = false;
 
   std::string line;
 
   while (getline(in, line)) {
-    std::vector<std::string> line_cells;
+    if (FeatureSchema::is_csv_comment(line)) {
+      unsigned count;
+      if (!FeatureSchema::from_csv_comment(line, file_hash, count)) {
+        std::cerr << "Unsupported dataset schema: " << line << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      has_comment = true;
+      continue;
+    }
+
+    std::vector<std::string> line_cells = split_csv_line(line);
+
+    if (line_cells.back() == "Label") {
+      std::vector<std::string> names;
+
+      for (unsigned i = 0; i < line_cells.size(); ++i) {
+        if (line_cells[i] == "Label")
+          label_column = i;
+        else if (line_cells[i] == "Phase")
+          phase_column = i;
+        else if (line_cells[i] == "Weight")
+          weight_column = i;
+        else
+          names.push_back(line_cells[i]);
+      }
+
+      if (has_comment && FeatureSchema::hash(names) != file_hash) {
+        std::cerr << "Dataset header does not match its schema hash "
+                  << FeatureSchema::hex(file_hash) << std::endl;
+        exit(EXIT_FAILURE);
+      }
 
-    std::stringstream ss(line);
-    std::string cell;
+      column = FeatureSchema::remap(names, cur.names);
 
-    while (std::getline(ss, cell, ',')) {
-      line_cells.push_back(cell);
+      if (FeatureSchema::hash(names) != cur.hash) {
+        std::cerr << "Dataset feature schema "
+                  << FeatureSchema::hex(FeatureSchema::hash(names))
+                  << " differs from " << FeatureSchema::hex(cur.hash)
+                  << ", remapping columns by name" << std::endl;
+
+        for (unsigned i = 0; i < feat_count; ++i)
+          if (column[i] < 0)
+            std::cerr << "  missing feature read as zero: " << cur.names[i]
+                      << std::endl;
+      }
+
+      for (unsigned i = 0; i < feat_count; ++i)
+        if (is_ablated(ablate, cur.names[i]))
+          column[i] = -1;
+      continue;
     }
 
     sample_type sample;
+    sample.set_size(feat_count);
 
     for (unsigned i = 0; i < feat_count; ++i) {
-      sample(i) = atof(line_cells[i].c_str());
+      sample(i) =
+          column[i] < 0 ? 0.0f : atof(line_cells[column[i]].c_str());
     }
 
     float label;
-    unsigned c = feat_count;
+    unsigned c = label_column;
 
     if (line_cells[c] == "Left")
       label = +1;
@@ -48,17 +195,18 @@ void load_train_test(std::istream &in, float test_perc,
     else
       assert(false);
 
-    if (rnd.get_random_32bit_number() % 100 > test_perc) {
-      train_samples.push_back(sample);
-      train_labels.push_back(label);
-    } else {
-      test_samples.push_back(sample);
-      test_labels.push_back(label);
-    }
+    int phase = phase_column < 0 ? -1 : atoi(line_cells[phase_column].c_str());
+    float weight =
+        weight_column < 0 ? 1.0f : atof(line_cells[weight_column].c_str());
+
+    if (rnd.get_random_32bit_number() % 100 > test_perc)
+      train.push_back(sample, label, phase, weight);
+    else
+      test.push_back(sample, label, phase, weight);
   }
 
-  std::cout << "Training sample size: " << train_samples.size() << std::endl
-            << "Test sample size: " << test_samples.size() << std::endl;
+  std::cout << "Training sample size: " << train.size() << std::endl
+            << "Test sample size: " << test.size() << std::endl;
 }
 
 #endif // #ifndef DATA_IO_INCLUDED
@@ -0,0 +1,72 @@
+#ifndef DEDUP_INCLUDED
+#define DEDUP_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Open addressing set of 64 bit keys, 8 bytes a slot. It starts with the power
+// of two of slots at or above 2 * expected (16 at least) and doubles when half
+// full, so past 16 slots it takes at most 32 * max(expected, keys) bytes, and
+// 16 more per key while growing.
+class KeySet {
+public:
+  KeySet(size_t expected = 1024);
+
+  // Returns true if the key was not in the set
+  bool insert(uint64_t key);
+  size_t size() const { return count; }
+
+private:
+  void grow();
+
+  std::vector<uint64_t> table;
+  size_t count;
+  bool has_zero;
+};
+
+// Bloom filter over 64 bit keys sized for 'expected' keys at a false positive
+// rate 'fp_rate'. Memory stays fixed however many keys are inserted.
+class BloomFilter {
+public:
+  BloomFilter(size_t expected, double fp_rate);
+
+  // Returns true if the key was (probably) not in the filter
+  bool insert(uint64_t key);
+
+  // Number of distinct keys estimated from the fraction of bits set
+  double cardinality() const;
+  size_t bytes() const { return bits.size() * sizeof(uint64_t); }
+
+private:
+  std::vector<uint64_t> bits;
+  uint64_t bit_count;
+  unsigned hash_count;
+  uint64_t bits_set;
+};
+
+// Dedup drops training samples comparing the same two positions, identified
+// by the Zobrist keys of both sides, as games sharing an opening prefix
+// produce the same comparisons over and over.
+class Dedup {
+public:
+  enum Mode { NONE, EXACT, BLOOM };
+
+  Dedup(Mode mode = EXACT, size_t expected = 1 << 20, double fp_rate = 0.001);
+
+  static Mode mode_from_name(const std::string &name);
+  static uint64_t pair_key(uint64_t left_key, uint64_t right_key);
+
+  // Returns true the first time a (left, right) pair is seen
+  bool insert(uint64_t left_key, uint64_t right_key);
+
+  std::string report() const;
+
+private:
+  Mode mode;
+  KeySet exact;
+  BloomFilter bloom;
+  uint64_t seen, kept;
+};
+
+#endif // #ifndef DEDUP_INCLUDED
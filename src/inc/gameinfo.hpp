@@ -1,8 +1,11 @@
 #ifndef GAME_INFO_INCLUDED
 #define GAME_INFO_INCLUDED
 
+#include "dedup.hpp"
+#include "pgn.hpp"
+#include "sampling.hpp"
 #include "utils.hpp"
-#include <random>
+#include <atomic>
 #include <vector>
 
 enum GameResult { BLACK_WON, WHITE_WON, DRAW };
@@ -11,8 +14,14 @@ enum MoveSampleStrategy {
   // sample at random
   UNIFORM,
   // sample according to a normal distribution
-  NORM
+  NORM,
+  // sample the moves whose positions look most informative after a cheap
+  // screening (legal moves, checks, captures, shallow search score spread)
+  SCREENED
 };
+
+// "uniform", "norm" or "screened"
+MoveSampleStrategy move_strategy_from_name(const std::string &name);
 enum CountSampleStrategy {
   // sample exactly a fixed number of moves.
   EXACTLY_N,
@@ -36,39 +45,86 @@ struct MoveBranch {
 
   std::vector<std::vector<std::string>> alt_continuations;
   std::vector<std::vector<GameFeature>> alt_continuations_features;
+
+  // Material game phase of the position featextract reads the features of,
+  // right after the true move (the continuation is not played there); it
+  // selects the comparator bucket
+  int phase = -1;
+
+  // Zobrist keys of the positions after the true and the alternative moves
+  uint64_t true_key = 0;
+  std::vector<uint64_t> alt_keys;
+};
+
+// One comparison of the positions after a played move and after one of its
+// alternatives: the feature differences played - alternative, labelled Left.
+// The same comparison labelled Right has the negated differences.
+struct TrainSample {
+  std::vector<int16_t> diffs;
+  int phase = -1;
+  float weight = 1.0f;
+};
+
+// GameRecord is a game as parsed from the input, before any engine work. It
+// is cheap to build, so a corpus can be counted or filtered on it.
+struct GameRecord {
+  unsigned id = 0;
+  GameResult result = DRAW;
+  unsigned white_elo = 0;
+  unsigned black_elo = 0;
+  std::vector<std::string> moves;
+
+  // Returns false (with a message) if the game cannot be replayed or has no
+  // result. 'id' is used unless the game has a GameId tag.
+  bool from_pgn(const PgnGame &game, unsigned id);
+};
+
+// GameFilter selects the games worth expanding, before any engine work.
+struct GameFilter {
+  unsigned min_elo = 0; // both players, unrated players count as 0
+  unsigned min_ply = 0;
+  unsigned max_ply = 0; // 0 means no limit
+
+  // Draws have no winner: if accepted, the moves of both sides are sampled
+  bool white_wins = true, black_wins = true, draws = false;
+
+  // Sets the accepted results from a list like "1-0,0-1,1/2-1/2"
+  void set_results(const std::string &results);
+  bool accept(const GameRecord &game) const;
 };
 
 class TrainGame {
 private:
-  unsigned id;
-  GameResult result;
-  unsigned ply_count;
-  unsigned white_elo;
-  unsigned black_elo;
+  GameRecord record;
 
-  std::vector<std::string> total_move_line;
   std::vector<unsigned> sampled_winner_moves_indices;
   std::vector<MoveBranch> sampled_moves_branches;
 
+  // Reseeded for every game from 'seed' and the game id
+  PRNG rng = PRNG(1);
+
   void reset() {
-    total_move_line.clear();
     sampled_moves_branches.clear();
     sampled_winner_moves_indices.clear();
   }
 
+  // Moves of the winner, of both sides for a draw
   std::vector<unsigned> get_winner_moves_indices() {
     std::vector<unsigned> indices;
 
-    unsigned index = this->result == WHITE_WON ? 0 : 1;
+    unsigned index = this->record.result == BLACK_WON ? 1 : 0;
+    unsigned step = this->record.result == DRAW ? 1 : 2;
 
-    while (index < this->total_move_line.size()) {
+    while (index < this->record.moves.size()) {
       indices.push_back(index);
-      index += 2;
+      index += step;
     }
 
     return indices;
   }
 
+  float sample_weight(unsigned index) const;
+
   MoveBranch get_move_branch(unsigned index);
 
   template <CountSampleStrategy Strategy, typename Limit>
@@ -80,9 +136,35 @@ public:
   const unsigned continuation_size = 8;
   const unsigned movetime = 20;
 
-  bool from_lines(std::vector<std::string>);
+  // Samples weight the trainer's loss by the mover's expected score against
+  // the opponent, 2 / (1 + 10^(-elo_diff / elo_weight_scale)): 1 between
+  // equal players, less when the winner was the underdog. 0 disables it, as
+  // do unrated players.
+  double elo_weight_scale = 400;
+
+  MoveSampleStrategy move_strategy = UNIFORM;
+  // Depth of the MultiPV search screening positions for SCREENED
+  unsigned screen_depth = 6;
+
+  // Alternatives to the played move that get a continuation
+  AltSelection alt_selection;
+
+  // Seed of the run; the moves sampled from a game depend only on it and on
+  // the game id, not on the order or the worker the game is expanded on.
+  uint64_t seed = 42;
+
+  // Samples the winner's moves of 'game' and expands each into a MoveBranch,
+  // which costs several engine searches per branch. Returns false, leaving
+  // the game without branches, if 'cancel' is raised in the meantime.
+  bool expand(const GameRecord &game,
+              const std::atomic<bool> *cancel = nullptr);
+
+  const GameRecord &game() const { return record; }
   std::vector<std::string> to_lines();
-  std::vector<std::string> to_csv_lines();
+  // Pairs of positions already seen by 'dedup' (if any) are left out
+  std::vector<TrainSample> to_samples(Dedup *dedup = nullptr);
+  // Left and Right lines of every sample
+  std::vector<std::string> to_csv_lines(Dedup *dedup = nullptr);
 };
 
 #endif // #ifndef GAME_INFO_INCLUDED
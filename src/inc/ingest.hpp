@@ -0,0 +1,102 @@
+#ifndef INGEST_INCLUDED
+#define INGEST_INCLUDED
+
+#include "pgn.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// MappedFile maps a whole file read only (on Windows it is read into memory).
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool is_open() const { return opened; }
+  const char *data() const { return begin; }
+  size_t size() const { return length; }
+
+private:
+  const char *begin;
+  size_t length;
+  bool opened;
+  std::vector<char> copy;
+};
+
+// True if the text holds PGN (tag pairs) rather than the GameId line format
+bool is_pgn(const char *data, size_t size);
+
+// Splits the text into chunks of about 'chunk_size' bytes, each starting at a
+// game boundary: an '[Event' tag for PGN, the line after GAME_END otherwise.
+// Returns the (offset, length) of every chunk.
+std::vector<std::pair<size_t, size_t>> split_chunks(const char *data,
+                                                    size_t size,
+                                                    size_t chunk_size, bool pgn);
+
+// Parses the games of one chunk of the GameId line format. Moves are already
+// in coordinate notation, the GameId, Elo and Result lines become tags.
+void parse_game_lines(const char *data, size_t size,
+                      std::vector<PgnGame> &games);
+
+struct IngestOptions {
+  unsigned threads = 0;       // 0 means one per hardware thread
+  size_t chunk_size = 1 << 20;
+  unsigned window = 0;        // chunks parsed ahead, 0 means 2 per thread
+  size_t start = 0;           // offset of the game boundary to start from
+};
+
+// Ingest parses the games of a text on a pool of threads, one chunk at a time,
+// and hands them out in input order. At most 'window' chunks are parsed ahead
+// of the consumer, which bounds memory whatever the size of the input.
+class Ingest {
+public:
+  Ingest(const char *data, size_t size,
+         const IngestOptions &options = IngestOptions());
+  ~Ingest();
+
+  // Next game in input order, returns false once every game was handed out
+  bool next(PgnGame &game);
+
+  // The next game is game 'skip' of the chunk starting at byte 'offset'.
+  // Resuming from 'offset' and dropping 'skip' games continues from here.
+  void position(uint64_t &offset, uint64_t &skip);
+
+  uint64_t games() const { return game_count; }
+  uint64_t bytes() const { return byte_count; }
+
+  // Games and bytes handed out per second, and the parsing rate per thread
+  std::string report() const;
+
+private:
+  struct Slot {
+    std::vector<PgnGame> games;
+    bool ready = false;
+  };
+
+  void worker();
+
+  const char *data;
+  size_t end_offset;
+  bool pgn;
+  std::vector<std::pair<size_t, size_t>> chunks;
+  std::vector<Slot> slots;
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t next_chunk, current_chunk, current_game;
+  bool stop;
+
+  uint64_t game_count, byte_count;
+  double parse_seconds;
+  std::chrono::steady_clock::time_point start;
+};
+
+#endif // #ifndef INGEST_INCLUDED
@@ -8,30 +8,15 @@
 
 static const std::string GAME_END = "----------------------------------------";
 
-template <typename InputStream>
-bool get_game(TrainGame &game, InputStream &input_stream) {
-  std::vector<std::string> lines;
-  std::string line;
-
-  while (getline(input_stream, line)) {
-    if (line == GAME_END) {
-      break;
-    } else {
-      lines.push_back(line);
-    }
-  }
-
-  return lines.size() > 0 ? game.from_lines(lines) : false;
-}
-
 template <typename OutputStream>
-void put_game(TrainGame &game, OutputStream &output_stream, std::string type) {
+void put_game(TrainGame &game, OutputStream &output_stream, std::string type,
+              Dedup *dedup = nullptr) {
   std::vector<std::string> lines;
 
   if (type == "lines")
     lines = game.to_lines();
   else if (type == "csv_lines")
-    lines = game.to_csv_lines();
+    lines = game.to_csv_lines(dedup);
   else
     assert(false);
 
@@ -2,67 +2,128 @@
 #define LEARN_INCLUDED
 
 #include "data_io.hpp"
+#include "mlp.h"
 #include "poscomp.h"
-#include <dlib/dnn.h>
+#include "trainer.hpp"
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <stdlib.h>
 #include <vector>
 
 using namespace dlib;
 
-template <typename net_type, typename sample_type>
-double get_net_accuracy(net_type &net, std::vector<sample_type> &samples,
+static const std::string DEFAULT_TOPOLOGY = "230:htan,1:linear";
+
+template <typename sample_type>
+double get_net_accuracy(const MLP::Network &net,
+                        std::vector<sample_type> &samples,
                         std::vector<float> &labels) {
-  std::vector<float> predicted_labels = net(samples);
   int num_right = 0;
   int num_wrong = 0;
 
   for (size_t i = 0; i < samples.size(); ++i) {
-    if ((predicted_labels[i] > 0 && labels[i] > 0) ||
-        (predicted_labels[i] < 0 && labels[i] < 0))
+    float predicted_label = net.evaluate(&samples[i](0));
+
+    if ((predicted_label > 0 && labels[i] > 0) ||
+        (predicted_label < 0 && labels[i] < 0))
       ++num_right;
     else
       ++num_wrong;
   }
 
-  return num_right * 100.0 / (double)(num_right + num_wrong);
+  return samples.empty() ? 0.0
+                         : num_right * 100.0 / (double)(num_right + num_wrong);
+}
+
+// The samples of one phase bucket. Samples of unknown phase (datasets
+// generated before the phase column existed) are used by every bucket.
+template <typename sample_type>
+SampleSet<sample_type> bucket_samples(const SampleSet<sample_type> &set,
+                                      const CompModel &model, unsigned b) {
+  SampleSet<sample_type> subset;
+
+  for (size_t i = 0; i < set.size(); ++i)
+    if (set.phases[i] < 0 || model.bucket(set.phases[i]) == b)
+      subset.push_back(set.samples[i], set.labels[i], set.phases[i],
+                       set.weights[i]);
+
+  return subset;
 }
 
-void train(std::istream &in, std::ostream &out) {
-  std::vector<sample_type> train_samples, test_samples;
-  std::vector<float> train_labels, test_labels;
-
-  load_train_test(in, 10, train_samples, train_labels, test_samples,
-                  test_labels);
-
-  net_type net;
-
-  dnn_trainer<net_type, adam> trainer(net, adam(0.0, 0.9, 0.999));
-  trainer.set_learning_rate(1e-4);
-  trainer.set_learning_rate_shrink_factor(1);
-  trainer.set_mini_batch_size(8);
-
-  std::cout.precision(2);
-
-  for (int e = 5; e < 300; e += 5) {
-    trainer.set_max_num_epochs(e);
-    trainer.train(train_samples, train_labels);
-    std::cout << " --- Epochs:" << std::setw(6) << e
-              << "    train acc: " << std::fixed
-              << get_net_accuracy<net_type, sample_type>(net, train_samples,
-                                                         train_labels)
-              << "    test acc: " << std::fixed
-              << get_net_accuracy<net_type, sample_type>(net, test_samples,
-                                                         test_labels)
-              << std::endl;
+std::vector<int> parse_phase_bounds(const std::string &bounds) {
+  std::vector<int> b;
+  std::stringstream ss(bounds);
+  std::string bound;
+
+  while (std::getline(ss, bound, ','))
+    b.push_back(std::stoi(bound));
+
+  return b;
+}
+
+// 'topology' lists the layers as width:activation, e.g. "64:relu,1:linear".
+// 'phase_bounds' splits the game phases into buckets trained separately, e.g.
+// "42,85" trains three nets; empty trains a single net for every phase.
+// Features listed in 'ablate' are read as zero, to measure what they add.
+void train(std::istream &in, std::ostream &out,
+           const std::string &topology = DEFAULT_TOPOLOGY,
+           const std::string &phase_bounds = "",
+           const std::vector<std::string> &ablate = {}) {
+  SampleSet<sample_type> train_set, test_set;
+
+  load_train_test(in, 10, train_set, test_set, ablate);
+
+  if (!train_set.size()) {
+    std::cerr << "No training samples" << std::endl;
+    return;
   }
 
-  trainer.get_net();
+  CompModel model;
+  model.bounds = parse_phase_bounds(phase_bounds);
+
+  for (unsigned b = 0; b <= model.bounds.size(); ++b) {
+    SampleSet<sample_type> train_b = bucket_samples(train_set, model, b);
+    SampleSet<sample_type> test_b = bucket_samples(test_set, model, b);
+
+    // A bucket without samples of its own gets a net trained on all of them,
+    // rather than an untrained one the engine would evaluate with
+    if (!train_b.size()) {
+      std::cout << "Bucket " << b << " has no samples, training it on all"
+                << std::endl;
+      train_b = train_set;
+      test_b = test_set;
+    }
+
+    MLP::Network net(FeatureSchema::current().names.size(), topology);
+
+    Trainer trainer(net, 1e-4, 0.9, 0.999, 8);
 
-  net.clean();
+    std::cout << "Bucket " << b << " of " << model.bounds.size() + 1
+              << "    topology: " << net.topology()
+              << "    samples: " << train_b.size() << std::endl;
+    std::cout.precision(2);
+
+    for (int e = 1; e < 300; ++e) {
+      trainer.train_epoch(train_b.samples, train_b.labels, train_b.weights);
+
+      if (e % 5)
+        continue;
+
+      std::cout << " --- Epochs:" << std::setw(6) << e
+                << "    train acc: " << std::fixed
+                << get_net_accuracy<sample_type>(net, train_b.samples,
+                                                 train_b.labels)
+                << "    test acc: " << std::fixed
+                << get_net_accuracy<sample_type>(net, test_b.samples,
+                                                 test_b.labels)
+                << std::endl;
+    }
+
+    model.nets.push_back(net);
+  }
 
-  serialize(net, out);
+  save_model(model, out);
 }
 
 #endif // #ifndef LEARN_INCLUDED
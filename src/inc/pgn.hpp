@@ -0,0 +1,61 @@
+#ifndef PGN_INCLUDED
+#define PGN_INCLUDED
+
+#include "position.h"
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct PgnGame {
+  std::vector<std::pair<std::string, std::string>> tags;
+  std::vector<std::string> moves; // coordinate notation, e.g. "e2e4"
+  std::string result;             // "1-0", "0-1", "1/2-1/2" or "*"
+  std::string error;              // set if the movetext could not be replayed
+
+  // Value of a tag pair, empty if the game has no such tag
+  std::string tag(const std::string &name) const;
+  void clear();
+};
+
+// Resolves a SAN move ("Nbd7", "exd8=Q+", "O-O") against the legal moves of
+// the position, returns MOVE_NONE if it matches none or more than one.
+Move san_to_move(const Position &pos, const char *san, size_t len);
+
+// PgnReader streams games from a PGN file through a fixed size buffer, so
+// memory stays bounded whatever the size of the input. Tag pairs are kept,
+// comments, variations, NAGs and move numbers are skipped, and SAN moves are
+// replayed on a Position and converted to coordinate notation.
+class PgnReader {
+public:
+  explicit PgnReader(std::istream &in, size_t buffer_size = 1 << 16);
+
+  // Reads the next game, returns false at the end of the input
+  bool next(PgnGame &game);
+
+  uint64_t games() const { return game_count; }
+  uint64_t bytes() const { return consumed + pos; }
+
+private:
+  int peek() { return pos < end || refill() ? (unsigned char)buffer[pos] : EOF; }
+  int get() { return pos < end || refill() ? (unsigned char)buffer[pos++] : EOF; }
+  bool refill();
+
+  void skip_space();
+  void skip_line();
+  void skip_comment();
+  void skip_variation();
+  size_t read_token(char *token, size_t size);
+  bool read_tag(PgnGame &game);
+  void play_move(PgnGame &game, const char *san, size_t len);
+
+  std::istream &in;
+  std::vector<char> buffer;
+  size_t pos, end;
+  uint64_t consumed, game_count;
+
+  Position position;
+  StateListPtr states;
+};
+
+#endif // #ifndef PGN_INCLUDED
@@ -0,0 +1,44 @@
+#ifndef PIPELINE_INCLUDED
+#define PIPELINE_INCLUDED
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Stage counts the items entering and leaving one step of the generation
+// pipeline (parse, filter, expand, write) and the time spent in it.
+class Stage {
+public:
+  explicit Stage(const std::string &name) : name(name) {}
+
+  // Times a scope and adds it to the stage
+  class Timer {
+  public:
+    explicit Timer(Stage &stage)
+        : stage(stage), start(std::chrono::steady_clock::now()) {}
+    ~Timer() {
+      std::chrono::duration<double> dt =
+          std::chrono::steady_clock::now() - start;
+      stage.seconds += dt.count();
+    }
+
+  private:
+    Stage &stage;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  void in(uint64_t count = 1) { items_in += count; }
+  void out(uint64_t count = 1) { items_out += count; }
+
+  std::string report() const;
+
+  const std::string name;
+  uint64_t items_in = 0, items_out = 0;
+  double seconds = 0;
+};
+
+// One line per stage: items in and out, time and items per second
+std::string report(const std::vector<const Stage *> &stages);
+
+#endif // #ifndef PIPELINE_INCLUDED
@@ -0,0 +1,102 @@
+#ifndef QUEUE_INCLUDED
+#define QUEUE_INCLUDED
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+
+// BoundedQueue is a fixed capacity multi producer, multi consumer queue
+// without locks (D. Vyukov's bounded MPMC queue). Every cell carries a
+// sequence number telling whether it is free for the producer of a given
+// position or holds the value for its consumer, so producers and consumers
+// only contend on their own position counter. Pushing to a full queue or
+// popping from an empty one fails instead of blocking.
+template <typename T> class BoundedQueue {
+public:
+  // The capacity is rounded up to a power of two
+  explicit BoundedQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+
+    mask = size - 1;
+    cells.reset(new Cell[size]);
+
+    for (size_t i = 0; i < size; ++i)
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+
+    enqueue_pos.store(0, std::memory_order_relaxed);
+    dequeue_pos.store(0, std::memory_order_relaxed);
+  }
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  bool try_push(T &&value) {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+    for (;;) {
+      Cell &cell = cells[pos & mask];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      ptrdiff_t diff = ptrdiff_t(seq) - ptrdiff_t(pos);
+
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0)
+        return false; // Full
+      else
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  bool try_pop(T &value) {
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+
+    for (;;) {
+      Cell &cell = cells[pos & mask];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      ptrdiff_t diff = ptrdiff_t(seq) - ptrdiff_t(pos + 1);
+
+      if (diff == 0) {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          value = std::move(cell.value);
+          cell.sequence.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0)
+        return false; // Empty
+      else
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  size_t capacity() const { return mask + 1; }
+
+  // Approximate while producers or consumers are running
+  size_t size() const {
+    size_t in = enqueue_pos.load(std::memory_order_relaxed);
+    size_t out = dequeue_pos.load(std::memory_order_relaxed);
+    return in > out ? in - out : 0;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  size_t mask;
+
+  // On separate cache lines, producers and consumers do not share one
+  alignas(64) std::atomic<size_t> enqueue_pos;
+  alignas(64) std::atomic<size_t> dequeue_pos;
+};
+
+#endif // #ifndef QUEUE_INCLUDED
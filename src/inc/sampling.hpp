@@ -0,0 +1,40 @@
+#ifndef SAMPLING_INCLUDED
+#define SAMPLING_INCLUDED
+
+#include "misc.h"
+#include <stdint.h>
+#include <vector>
+
+// Sampling of distinct indices without replacement. Every function draws from
+// a caller owned PRNG, so each worker keeps its own generator, and appends to
+// 'out' without any other allocation. Results are in ascending order.
+namespace Sampling {
+
+// Seed for the sampling of one game: differs from game to game but does not
+// depend on the order in which games are processed. Never 0, as PRNG needs.
+uint64_t seed(uint64_t run_seed, uint64_t id);
+
+// Uniform in [0, n) with Lemire's multiply-shift, n < 2^32
+inline unsigned below(PRNG &rng, unsigned n) {
+  return unsigned(((rng.rand<uint64_t>() >> 32) * n) >> 32);
+}
+
+// Uniform in [0, 1)
+inline double uniform01(PRNG &rng) {
+  return (rng.rand<uint64_t>() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// 'k' distinct indices of [0, n) chosen uniformly with Floyd's algorithm,
+// all of them if k >= n.
+void uniform(PRNG &rng, unsigned n, unsigned k, std::vector<unsigned> &out);
+
+// 'k' distinct indices of [0, n) where index i has the mass of a normal
+// distribution on [i - 0.5, i + 0.5), truncated to [-0.5, n - 0.5). Indices
+// are drawn one at a time by inverting the CDF of the mass not drawn yet, so
+// the cost does not grow as k approaches n.
+void normal(PRNG &rng, unsigned n, unsigned k, double mean, double stddev,
+            std::vector<unsigned> &out);
+
+} // namespace Sampling
+
+#endif // #ifndef SAMPLING_INCLUDED
@@ -0,0 +1,256 @@
+#ifndef STREAM_INCLUDED
+#define STREAM_INCLUDED
+
+#include "data_gen.hpp"
+#include "learn.hpp"
+#include "queue.hpp"
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+struct StreamOptions {
+  // Parsing, filtering, sampling and dedup as for generate(). The output and
+  // checkpoint options do not apply, nothing is written but the model.
+  GenerateOptions generate;
+
+  // Generator threads. The engine is a global and not thread safe, so only
+  // one of them expands a game at a time; the others parse, filter and hand
+  // their samples to the trainer meanwhile.
+  unsigned workers = 2;
+  // Samples waiting for the trainer; full, it holds the generators back
+  size_t queue_capacity = 4096;
+
+  // The trainer keeps the last 'replay_size' samples and takes 'replay_steps'
+  // optimizer steps on mini-batches of 'batch_size' drawn from them for every
+  // 'batch_size' new samples.
+  size_t replay_size = 1 << 16;
+  unsigned batch_size = 8;
+  unsigned replay_steps = 1;
+  double learning_rate = 1e-4;
+  std::string topology = DEFAULT_TOPOLOGY;
+
+  // Stop after this many samples, 0 runs over the whole input
+  uint64_t max_samples = 0;
+  // Seconds between progress reports
+  unsigned report_every = 10;
+};
+
+// ReplayBuffer holds the last 'capacity' samples. Mini-batches are drawn
+// uniformly from it, so the strongly correlated samples of one game are
+// spread over many optimizer steps.
+class ReplayBuffer {
+public:
+  explicit ReplayBuffer(size_t capacity) : capacity(capacity), next(0) {}
+
+  void push_back(const sample_type &sample, float label, float weight) {
+    if (samples.size() < capacity) {
+      samples.push_back(sample);
+      labels.push_back(label);
+      weights.push_back(weight);
+    } else {
+      samples[next] = sample;
+      labels[next] = label;
+      weights[next] = weight;
+    }
+
+    next = (next + 1) % capacity;
+  }
+
+  void batch(PRNG &rng, unsigned size, std::vector<unsigned> &indices) const {
+    indices.resize(size);
+
+    for (unsigned &i : indices)
+      i = Sampling::below(rng, samples.size());
+  }
+
+  std::vector<sample_type> samples;
+  std::vector<float> labels, weights;
+
+private:
+  size_t capacity, next;
+};
+
+/// stream() trains a comparator online from the games of 'path' without
+/// writing any dataset: generator threads expand games into samples and push
+/// them into a bounded lock free queue, the calling thread pops them into a
+/// replay buffer and trains from it. The model is saved to 'output' at the
+/// end. Adapter::run_uci_commands() redirects std::cout while the engine
+/// runs, so the trainer only prints while holding the engine lock.
+
+void stream(const std::string &path, const std::string &output,
+            const StreamOptions &options = StreamOptions()) {
+  MappedFile file(path);
+
+  if (!file.is_open()) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return;
+  }
+
+  const GenerateOptions &gen = options.generate;
+  unsigned feat_count = FeatureSchema::current().names.size();
+
+  Ingest ingest(file.data(), file.size(), gen.ingest);
+  Dedup dedup(Dedup::mode_from_name(gen.dedup), gen.dedup_expected,
+              gen.dedup_fp_rate);
+  BoundedQueue<TrainSample> queue(options.queue_capacity);
+
+  std::mutex ingest_mutex, engine_mutex;
+  std::atomic<bool> stop(false);
+  unsigned workers = std::max(options.workers, 1u);
+  std::atomic<unsigned> running(workers);
+  std::atomic<uint64_t> games(0), produced(0);
+
+  auto worker = [&]() {
+    PgnGame pgn;
+    GameRecord record;
+    TrainGame game;
+
+    game.elo_weight_scale = gen.elo_weight_scale;
+    game.seed = gen.seed;
+    game.move_strategy = move_strategy_from_name(gen.sampling);
+    game.screen_depth = gen.screen_depth;
+    game.alt_selection = gen.alt_selection;
+
+    while (!stop) {
+      uint64_t id;
+      {
+        std::lock_guard<std::mutex> lock(ingest_mutex);
+
+        if (!ingest.next(pgn))
+          break;
+        id = ingest.games();
+      }
+
+      if (!record.from_pgn(pgn, id) || !gen.filter.accept(record))
+        continue;
+
+      std::vector<TrainSample> samples;
+      {
+        std::lock_guard<std::mutex> lock(engine_mutex);
+
+        if (!game.expand(record, &stop))
+          break;
+        samples = game.to_samples(&dedup);
+      }
+      ++games;
+
+      for (TrainSample &s : samples) {
+        while (!stop && !queue.try_push(std::move(s)))
+          std::this_thread::yield();
+
+        if (stop)
+          break;
+
+        if (++produced == options.max_samples)
+          stop = true;
+      }
+    }
+
+    --running;
+  };
+
+  Adapter::init();
+
+  if (!gen.shared_hash.empty())
+    Adapter::set_option("Shared Hash Name", gen.shared_hash);
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < workers; ++i)
+    threads.emplace_back(worker);
+
+  MLP::Network net(feat_count, options.topology);
+  Trainer trainer(net, options.learning_rate, 0.9, 0.999,
+                  options.batch_size);
+  ReplayBuffer replay(options.replay_size);
+  // Mixed like the seed of a game, so that seed=0 is valid here too
+  PRNG rng(Sampling::seed(gen.seed, 0));
+
+  TrainSample s;
+  sample_type x;
+  std::vector<unsigned> indices;
+  uint64_t consumed = 0, steps = 0, fresh = 0;
+  double loss = 0.0;
+
+  auto start = std::chrono::steady_clock::now();
+  auto last_report = start;
+
+  auto seconds = [&]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  auto report = [&]() {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    double t = std::max(seconds(), 1e-9);
+
+    std::cout << std::fixed << std::setprecision(1) << " --- " << t
+              << " s    games: " << games << "    samples: " << consumed
+              << " (" << consumed / t << " /s)    steps: " << steps
+              << "    queue: " << queue.size() << "    loss: "
+              << std::setprecision(4) << loss << std::endl;
+  };
+
+  for (;;) {
+    if (gen.cancel && *gen.cancel)
+      stop = true;
+
+    // Workers are checked before the queue, so no sample can be left behind
+    bool done = running == 0;
+
+    if (!queue.try_pop(s)) {
+      if (done)
+        break;
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    ++consumed;
+    x.set_size(feat_count);
+
+    for (unsigned i = 0; i < feat_count; ++i)
+      x(i) = s.diffs[i];
+
+    // Every sample is trained both ways, as the Left and Right CSV rows are
+    replay.push_back(x, +1.0f, s.weight);
+    replay.push_back(-x, -1.0f, s.weight);
+    fresh += 2;
+
+    for (; fresh >= options.batch_size; fresh -= options.batch_size)
+      for (unsigned k = 0; k < options.replay_steps; ++k) {
+        replay.batch(rng, options.batch_size, indices);
+        double l = trainer.train_batch(replay.samples, replay.labels,
+                                       replay.weights, indices);
+        loss = steps++ ? 0.99 * loss + 0.01 * l : l;
+      }
+
+    if (options.report_every &&
+        std::chrono::steady_clock::now() - last_report >
+            std::chrono::seconds(options.report_every)) {
+      report();
+      last_report = std::chrono::steady_clock::now();
+    }
+  }
+
+  for (std::thread &t : threads)
+    t.join();
+
+  report();
+
+  double t = std::max(seconds(), 1e-9);
+  std::cout << "Games: " << games << "    samples: " << consumed
+            << "    end to end: " << std::setprecision(1) << consumed / t
+            << " samples/s    replay accuracy: "
+            << get_net_accuracy<sample_type>(net, replay.samples, replay.labels)
+            << std::endl
+            << dedup.report() << std::endl;
+
+  CompModel model;
+  model.nets.push_back(net);
+
+  std::ofstream out(output, std::ios::binary);
+  save_model(model, out);
+}
+
+#endif // #ifndef STREAM_INCLUDED
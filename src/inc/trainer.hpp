@@ -0,0 +1,51 @@
+#ifndef TRAINER_INCLUDED
+#define TRAINER_INCLUDED
+
+#include "mlp.h"
+#include "poscomp.h"
+#include <random>
+#include <vector>
+
+// Trains an MLP::Network as a binary classifier with the logistic loss
+// log(1 + exp(-label * output)) and the Adam optimizer, the same objective
+// dlib's loss_binary_log used before the network format became runtime
+// described.
+class Trainer {
+public:
+  Trainer(MLP::Network &net, double learning_rate = 1e-4, double beta1 = 0.9,
+          double beta2 = 0.999, unsigned mini_batch_size = 8);
+
+  // One pass over the samples in random order, returns the mean loss. Each
+  // sample's loss is scaled by its weight, all weights are 1 if empty.
+  double train_epoch(const std::vector<sample_type> &samples,
+                     const std::vector<float> &labels,
+                     const std::vector<float> &weights = {});
+
+  // One optimizer step over the samples at 'indices' (online training from a
+  // replay buffer), returns their mean loss.
+  double train_batch(const std::vector<sample_type> &samples,
+                     const std::vector<float> &labels,
+                     const std::vector<float> &weights,
+                     const std::vector<unsigned> &indices);
+
+private:
+  struct LayerState {
+    std::vector<float> grad_w, grad_b;
+    std::vector<float> m_w, v_w, m_b, v_b;
+  };
+
+  double backprop(const float *input, float label, float weight);
+  void step(unsigned batch_size);
+
+  MLP::Network &net;
+  double learning_rate, beta1, beta2;
+  unsigned mini_batch_size;
+  unsigned long steps;
+
+  std::vector<LayerState> state;
+  std::vector<std::vector<float>> acts;
+  std::vector<float> delta, prev_delta;
+  std::default_random_engine generator;
+};
+
+#endif // #ifndef TRAINER_INCLUDED
@@ -1,21 +1,35 @@
 #ifndef UTILS_INCLUDED
 #define UTILS_INCLUDED
 
-#include <random>
+#include "misc.h"
+#include <string>
 #include <vector>
 
+// Cheap signals of how informative a position is as a training sample, see
+// the engine's 'screen' command.
+struct ScreenInfo {
+  unsigned legal_moves = 0;
+  unsigned checkers = 0;
+  bool after_capture = false; // the last move captured, a recapture may follow
+  int spread = 0;             // internal Value gap between the two best moves
+};
+
+// Which alternatives to the played move get a continuation. Every legal move
+// by default; with 'see' moves losing material in a static exchange are
+// dropped first; with 'top_k' only the k best by a MultiPV search to 'depth'
+// are kept, plus 'random_tail' others picked at random for diversity.
+struct AltSelection {
+  bool see = false;
+  unsigned top_k = 0;
+  unsigned depth = 4;
+  unsigned random_tail = 0;
+};
+
 class Utils {
 public:
   // define a pure virtual destructor to make this class abstract
   virtual ~Utils() = 0;
 
-  static std::normal_distribution<double>
-  generate_normal_distribution(unsigned num_elements);
-
-  template <typename T>
-  static std::vector<unsigned>
-  sample_indices(T distribution, unsigned num_elements, unsigned num_samples);
-
   static std::string uci_init_moves_cmd(std::vector<std::string> moves);
 
   static std::vector<std::string>
@@ -24,6 +38,13 @@ public:
 
   static std::vector<std::string>
   get_alt_moves(std::vector<std::string> init_moves, std::string move);
+
+  static std::vector<std::string>
+  select_alt_moves(std::vector<std::string> init_moves, std::string move,
+                   const AltSelection &selection, PRNG &rng);
+
+  static ScreenInfo screen(std::vector<std::string> init_moves,
+                           unsigned depth);
 };
 
 #endif // #ifndef UTILS_INCLUDED
@@ -0,0 +1,313 @@
+#include "ingest.hpp"
+#include "adapter.h"
+#include "io.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Lets a PgnReader read a chunk of the mapped file without copying it
+struct MemoryBuffer : std::streambuf {
+  MemoryBuffer(const char *data, size_t size) {
+    char *p = const_cast<char *>(data);
+    setg(p, p, p + size);
+  }
+};
+
+const char *find(const char *first, const char *last, const std::string &s) {
+  const char *p = std::search(first, last, s.begin(), s.end());
+  return p == last ? nullptr : p;
+}
+
+// Offset of the first game boundary at or after 'offset'
+size_t next_boundary(const char *data, size_t size, size_t offset, bool pgn) {
+  if (offset == 0)
+    return 0;
+
+  if (pgn) {
+    const char *p = find(data + offset - 1, data + size, "\n[Event ");
+    return p ? p + 1 - data : size;
+  }
+
+  const char *p = find(data + offset - 1, data + size, "\n" + GAME_END);
+
+  while (p && p + 1 + GAME_END.size() < data + size &&
+         !strchr("\r\n", p[1 + GAME_END.size()]))
+    p = find(p + 1, data + size, "\n" + GAME_END);
+
+  if (!p)
+    return size;
+
+  const char *eol = static_cast<const char *>(
+      memchr(p + 1, '\n', data + size - p - 1));
+  return eol ? eol + 1 - data : size;
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::string &path)
+    : begin(nullptr), length(0), opened(false) {
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat st;
+
+  if (fd < 0)
+    return;
+
+  if (fstat(fd, &st) == 0) {
+    length = st.st_size;
+    opened = true;
+
+    if (length) {
+      void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (p == MAP_FAILED)
+        opened = false, length = 0;
+      else {
+        madvise(p, length, MADV_SEQUENTIAL);
+        begin = static_cast<const char *>(p);
+      }
+    }
+  }
+
+  close(fd);
+#else
+  std::ifstream in(path, std::ios::binary);
+
+  if (!in)
+    return;
+
+  copy.assign(std::istreambuf_iterator<char>(in),
+              std::istreambuf_iterator<char>());
+  begin = copy.data();
+  length = copy.size();
+  opened = true;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (length)
+    munmap(const_cast<char *>(begin), length);
+#endif
+}
+
+bool is_pgn(const char *data, size_t size) {
+  size_t i = 0;
+
+  while (i < size && isspace((unsigned char)data[i]))
+    ++i;
+
+  return i < size && data[i] == '[';
+}
+
+std::vector<std::pair<size_t, size_t>>
+split_chunks(const char *data, size_t size, size_t chunk_size, bool pgn) {
+  std::vector<std::pair<size_t, size_t>> chunks;
+  size_t first = 0;
+
+  while (first < size) {
+    size_t last = first + chunk_size < size
+                      ? next_boundary(data, size, first + chunk_size, pgn)
+                      : size;
+
+    chunks.emplace_back(first, last - first);
+    first = last;
+  }
+
+  return chunks;
+}
+
+void parse_game_lines(const char *data, size_t size,
+                      std::vector<PgnGame> &games) {
+  const char *p = data, *end = data + size;
+  bool move_lines = false, started = false;
+  PgnGame game;
+
+  while (p < end) {
+    const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    std::string line(p, eol ? eol : end);
+    p = eol ? eol + 1 : end;
+
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+
+    if (line == GAME_END) {
+      if (started)
+        games.push_back(std::move(game));
+
+      game.clear();
+      move_lines = started = false;
+      continue;
+    }
+
+    std::stringstream ss(line);
+    std::string key, val;
+
+    ss >> key >> val;
+
+    if (key.empty())
+      continue;
+
+    started = true;
+
+    if (line == "Moves")
+      move_lines = true;
+    else if (move_lines)
+      game.moves.push_back(val);
+    else if (key == "Result")
+      game.result = val;
+    else
+      game.tags.emplace_back(key, val);
+  }
+
+  if (started)
+    games.push_back(std::move(game));
+}
+
+Ingest::Ingest(const char *data, size_t size, const IngestOptions &options)
+    : data(data), end_offset(size), pgn(is_pgn(data, size)), next_chunk(0),
+      current_chunk(0), current_game(0), stop(false), game_count(0),
+      byte_count(0), parse_seconds(0),
+      start(std::chrono::steady_clock::now()) {
+  unsigned n = options.threads ? options.threads
+                               : std::max(1u, std::thread::hardware_concurrency());
+  size_t first = std::min(options.start, size);
+
+  chunks = split_chunks(data + first, size - first,
+                        std::max<size_t>(options.chunk_size, 1), pgn);
+  for (auto &c : chunks)
+    c.first += first;
+
+  slots.resize(options.window ? options.window : 2 * n);
+
+  // Workers replay moves on their own Position, the engine must be set up
+  // before they start.
+  Adapter::init();
+
+  for (unsigned i = 0; i < n; ++i)
+    threads.emplace_back(&Ingest::worker, this);
+}
+
+Ingest::~Ingest() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+
+  cv.notify_all();
+
+  for (std::thread &t : threads)
+    t.join();
+}
+
+/// worker() claims the next chunk once its slot is free, i.e. once the chunk
+/// 'window' places before it was consumed, and parses it without the lock.
+
+void Ingest::worker() {
+  while (true) {
+    size_t idx;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] {
+        return stop || next_chunk >= chunks.size() ||
+               next_chunk < current_chunk + slots.size();
+      });
+
+      if (stop || next_chunk >= chunks.size())
+        return;
+
+      idx = next_chunk++;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    const char *chunk = data + chunks[idx].first;
+    std::vector<PgnGame> games;
+
+    if (pgn) {
+      MemoryBuffer buf(chunk, chunks[idx].second);
+      std::istream in(&buf);
+      PgnReader reader(in);
+      PgnGame game;
+
+      while (reader.next(game))
+        games.push_back(game);
+    } else
+      parse_game_lines(chunk, chunks[idx].second, games);
+
+    std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      Slot &slot = slots[idx % slots.size()];
+      slot.games = std::move(games);
+      slot.ready = true;
+      parse_seconds += dt.count();
+    }
+
+    cv.notify_all();
+  }
+}
+
+bool Ingest::next(PgnGame &game) {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (current_chunk < chunks.size()) {
+    Slot &slot = slots[current_chunk % slots.size()];
+    cv.wait(lock, [&] { return slot.ready; });
+
+    if (current_game < slot.games.size()) {
+      game = std::move(slot.games[current_game++]);
+      ++game_count;
+      return true;
+    }
+
+    // Chunk exhausted, free its slot for the chunk 'window' places ahead
+    byte_count += chunks[current_chunk].second;
+    slot.games.clear();
+    slot.ready = false;
+    current_game = 0;
+    ++current_chunk;
+    cv.notify_all();
+  }
+
+  return false;
+}
+
+void Ingest::position(uint64_t &offset, uint64_t &skip) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  offset = current_chunk < chunks.size() ? chunks[current_chunk].first
+                                         : end_offset;
+  skip = current_game;
+}
+
+std::string Ingest::report() const {
+  std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+  double mb = byte_count / double(1 << 20);
+  std::stringstream ss;
+
+  ss << std::fixed << std::setprecision(1) << "Ingested " << game_count
+     << " games, " << mb << " MB in " << wall.count() << " s: "
+     << game_count / wall.count() << " games/s, " << mb / wall.count()
+     << " MB/s";
+
+  if (parse_seconds > 0)
+    ss << " (parsing alone " << game_count / parse_seconds
+       << " games/s, " << mb / parse_seconds << " MB/s per thread on "
+       << threads.size() << " threads)";
+
+  return ss.str();
+}
@@ -1,19 +1,163 @@
 #include "data_gen.hpp"
 #include "learn.hpp"
+#include "stream.hpp"
+#include <atomic>
+#include <csignal>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <sstream>
+
+// Arguments after the input and output files are given as name=value
+std::map<std::string, std::string> parse_options(int argc, char **argv) {
+  std::map<std::string, std::string> options;
+
+  for (int i = 4; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+
+    assert(eq != std::string::npos);
+    options[arg.substr(0, eq)] = arg.substr(eq + 1);
+  }
+
+  return options;
+}
+
+// Options shared by generate and stream
+GenerateOptions generate_options(std::map<std::string, std::string> &options) {
+  GenerateOptions gen;
+
+  if (options.count("dedup"))
+    gen.dedup = options["dedup"];
+  if (options.count("dedup_expected"))
+    gen.dedup_expected = std::stoull(options["dedup_expected"]);
+  if (options.count("dedup_fp_rate"))
+    gen.dedup_fp_rate = std::stod(options["dedup_fp_rate"]);
+  if (options.count("threads"))
+    gen.ingest.threads = std::stoi(options["threads"]);
+  if (options.count("chunk_size"))
+    gen.ingest.chunk_size = std::stoull(options["chunk_size"]);
+  if (options.count("min_elo"))
+    gen.filter.min_elo = std::stoi(options["min_elo"]);
+  if (options.count("min_ply"))
+    gen.filter.min_ply = std::stoi(options["min_ply"]);
+  if (options.count("max_ply"))
+    gen.filter.max_ply = std::stoi(options["max_ply"]);
+  if (options.count("results"))
+    gen.filter.set_results(options["results"]);
+  if (options.count("elo_weight_scale"))
+    gen.elo_weight_scale = std::stod(options["elo_weight_scale"]);
+  if (options.count("seed"))
+    gen.seed = std::stoull(options["seed"]);
+  if (options.count("sampling"))
+    gen.sampling = options["sampling"];
+  if (options.count("screen_depth"))
+    gen.screen_depth = std::stoi(options["screen_depth"]);
+  if (options.count("alt_see"))
+    gen.alt_selection.see = std::stoi(options["alt_see"]);
+  if (options.count("alt_top_k"))
+    gen.alt_selection.top_k = std::stoi(options["alt_top_k"]);
+  if (options.count("alt_depth"))
+    gen.alt_selection.depth = std::stoi(options["alt_depth"]);
+  if (options.count("alt_random"))
+    gen.alt_selection.random_tail = std::stoi(options["alt_random"]);
+  if (options.count("shared_hash"))
+    gen.shared_hash = options["shared_hash"];
+  if (options.count("expand"))
+    gen.expand = std::stoi(options["expand"]);
+  if (options.count("resume"))
+    gen.resume = std::stoi(options["resume"]);
+  if (options.count("checkpoint_every"))
+    gen.checkpoint_every = std::stoi(options["checkpoint_every"]);
+
+  return gen;
+}
+
+static std::atomic<bool> STOP(false);
 
 int main(int argc, char **argv) {
   std::string mode = argv[1];
 
-  std::ifstream in(argv[2]);
-  std::ofstream out(argv[3]);
+  auto options = parse_options(argc, argv);
+
+  if (mode == "train") {
+    std::ifstream in(argv[2], std::ios::binary);
+    std::ofstream out(argv[3], std::ios::binary);
+
+    if (!Columnar::is_columnar(in)) {
+      in.close();
+      in.open(argv[2]);
+    }
+
+    std::vector<std::string> ablate;
+    std::stringstream ss(options["ablate"]);
+    for (std::string name; std::getline(ss, name, ',');)
+      ablate.push_back(name);
+
+    train(in, out,
+          options.count("topology") ? options["topology"] : DEFAULT_TOPOLOGY,
+          options["buckets"], ablate);
+  } else if (mode == "convert") {
+    std::ifstream in(argv[2]);
+    std::ofstream out(argv[3], std::ios::binary);
+
+    auto rows = Columnar::convert(
+        in, out,
+        options.count("block_rows") ? std::stoi(options["block_rows"]) : 16384);
+
+    if (rows < 0) {
+      std::cerr << "No dataset header in " << argv[2] << std::endl;
+      return 1;
+    }
+
+    in.clear();
+    in.seekg(0, std::ios::end);
+    std::cout << "Rows: " << rows << "    bytes: " << in.tellg() << " -> "
+              << out.tellp() << std::endl;
+  } else if (mode == "generate") {
+    GenerateOptions gen = generate_options(options);
+
+    // Ctrl-C finishes writing the current output instead of cutting a game
+    gen.cancel = &STOP;
+    std::signal(SIGINT, [](int) { STOP = true; });
+
+    generate(argv[2], argv[3], gen);
+  } else if (mode == "stream") {
+    StreamOptions stream_options;
+    stream_options.generate = generate_options(options);
+
+    if (options.count("workers"))
+      stream_options.workers = std::stoi(options["workers"]);
+    if (options.count("queue"))
+      stream_options.queue_capacity = std::stoull(options["queue"]);
+    if (options.count("replay"))
+      stream_options.replay_size = std::stoull(options["replay"]);
+    if (options.count("batch"))
+      stream_options.batch_size = std::stoi(options["batch"]);
+    if (options.count("replay_steps"))
+      stream_options.replay_steps = std::stoi(options["replay_steps"]);
+    if (options.count("learning_rate"))
+      stream_options.learning_rate = std::stod(options["learning_rate"]);
+    if (options.count("topology"))
+      stream_options.topology = options["topology"];
+    if (options.count("max_samples"))
+      stream_options.max_samples = std::stoull(options["max_samples"]);
+    if (options.count("report_every"))
+      stream_options.report_every = std::stoi(options["report_every"]);
+
+    if (!stream_options.batch_size ||
+        stream_options.replay_size < stream_options.batch_size) {
+      std::cerr << "replay must be at least batch, and batch positive"
+                << std::endl;
+      return 1;
+    }
+
+    // Ctrl-C stops the generators, the trainer drains the queue and saves
+    stream_options.generate.cancel = &STOP;
+    std::signal(SIGINT, [](int) { STOP = true; });
 
-  if (mode == "train")
-    train(in, out);
-  else if (mode == "generate")
-    generate(in, out);
-  else
+    stream(argv[2], argv[3], stream_options);
+  } else
     assert(false);
 
   return 0;
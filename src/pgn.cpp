@@ -0,0 +1,308 @@
+#include "pgn.hpp"
+#include "adapter.h"
+#include "movegen.h"
+#include "uci.h"
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+PieceType piece_type_from_char(char c) {
+  switch (c) {
+  case 'N': return KNIGHT;
+  case 'B': return BISHOP;
+  case 'R': return ROOK;
+  case 'Q': return QUEEN;
+  case 'K': return KING;
+  default:  return NO_PIECE_TYPE;
+  }
+}
+
+bool is_result(const char *token) {
+  return !strcmp(token, "1-0") || !strcmp(token, "0-1") ||
+         !strcmp(token, "1/2-1/2") || !strcmp(token, "*");
+}
+
+} // namespace
+
+std::string PgnGame::tag(const std::string &name) const {
+  for (const auto &t : tags)
+    if (t.first == name)
+      return t.second;
+
+  return "";
+}
+
+void PgnGame::clear() {
+  tags.clear();
+  moves.clear();
+  result.clear();
+  error.clear();
+}
+
+Move san_to_move(const Position &pos, const char *san, size_t len) {
+  char s[16];
+  size_t n = 0;
+
+  // Drop check, mate and annotation suffixes ("+", "#", "!?", ...)
+  for (size_t i = 0; i < len && n < sizeof(s) - 1; ++i)
+    if (!strchr("+#!?", san[i]))
+      s[n++] = san[i];
+  s[n] = 0;
+
+  if (!strcmp(s, "O-O") || !strcmp(s, "0-0") || !strcmp(s, "O-O-O") ||
+      !strcmp(s, "0-0-0")) {
+    bool king_side = n == 3;
+
+    for (const auto &m : MoveList<LEGAL>(pos))
+      if (type_of(m) == CASTLING && (to_sq(m) > from_sq(m)) == king_side)
+        return m;
+
+    return MOVE_NONE;
+  }
+
+  PieceType pt = piece_type_from_char(s[0]);
+  size_t first = pt == NO_PIECE_TYPE ? 0 : 1;
+  PieceType promotion = NO_PIECE_TYPE;
+
+  if (pt == NO_PIECE_TYPE)
+    pt = PAWN;
+
+  // Promotion, written "e8=Q" or "e8Q"
+  if (pt == PAWN && n > 2 && piece_type_from_char(s[n - 1]) != NO_PIECE_TYPE) {
+    promotion = piece_type_from_char(s[n - 1]);
+    n -= s[n - 2] == '=' ? 2 : 1;
+  }
+
+  if (n < first + 2 || s[n - 2] < 'a' || s[n - 2] > 'h' || s[n - 1] < '1' ||
+      s[n - 1] > '8')
+    return MOVE_NONE;
+
+  Square to = make_square(File(s[n - 2] - 'a'), Rank(s[n - 1] - '1'));
+  int file = -1, rank = -1;
+
+  for (size_t i = first; i < n - 2; ++i)
+    if (s[i] >= 'a' && s[i] <= 'h')
+      file = s[i] - 'a';
+    else if (s[i] >= '1' && s[i] <= '8')
+      rank = s[i] - '1';
+    else if (s[i] != 'x' && s[i] != '-' && s[i] != ':')
+      return MOVE_NONE;
+
+  Move found = MOVE_NONE;
+
+  for (const auto &m : MoveList<LEGAL>(pos)) {
+    Square from = from_sq(m);
+
+    if (type_of(m) == CASTLING || to_sq(m) != to ||
+        type_of(pos.moved_piece(m)) != pt ||
+        (file >= 0 && file_of(from) != file) ||
+        (rank >= 0 && rank_of(from) != rank) ||
+        (type_of(m) == PROMOTION ? promotion_type(m) != promotion
+                                 : promotion != NO_PIECE_TYPE))
+      continue;
+
+    if (found != MOVE_NONE)
+      return MOVE_NONE; // Ambiguous
+
+    found = m;
+  }
+
+  return found;
+}
+
+PgnReader::PgnReader(std::istream &in, size_t buffer_size)
+    : in(in), buffer(buffer_size), pos(0), end(0), consumed(0),
+      game_count(0) {
+  Adapter::init();
+}
+
+bool PgnReader::refill() {
+  consumed += end;
+  pos = end = 0;
+
+  if (!in)
+    return false;
+
+  in.read(buffer.data(), buffer.size());
+  end = in.gcount();
+
+  return end > 0;
+}
+
+void PgnReader::skip_space() {
+  while (isspace(peek()))
+    get();
+}
+
+void PgnReader::skip_line() {
+  int c;
+  while ((c = get()) != EOF && c != '\n') {
+  }
+}
+
+void PgnReader::skip_comment() {
+  int c;
+  while ((c = get()) != EOF && c != '}') {
+  }
+}
+
+// Variations nest and may contain comments, which may contain parentheses
+void PgnReader::skip_variation() {
+  int depth = 0, c;
+
+  while ((c = get()) != EOF) {
+    if (c == '{')
+      skip_comment();
+    else if (c == ';')
+      skip_line();
+    else if (c == '(')
+      ++depth;
+    else if (c == ')' && --depth == 0)
+      return;
+  }
+}
+
+size_t PgnReader::read_token(char *token, size_t size) {
+  size_t len = 0;
+  int c;
+
+  while ((c = peek()) != EOF && !isspace(c) && !strchr("{}()[];$", c)) {
+    get();
+    if (len < size - 1)
+      token[len++] = c;
+  }
+
+  token[len] = 0;
+  return len;
+}
+
+// Reads '[Name "Value"]', the opening bracket has already been consumed
+bool PgnReader::read_tag(PgnGame &game) {
+  std::string name, value;
+  int c;
+
+  skip_space();
+  while ((c = peek()) != EOF && !isspace(c) && c != '"' && c != ']')
+    name += get();
+
+  skip_space();
+  if (get() != '"') {
+    skip_line();
+    return false;
+  }
+
+  while ((c = get()) != EOF && c != '"') {
+    if (c == '\\')
+      c = get();
+    value += c;
+  }
+
+  while ((c = get()) != EOF && c != ']' && c != '\n') {
+  }
+
+  game.tags.emplace_back(name, value);
+  return true;
+}
+
+void PgnReader::play_move(PgnGame &game, const char *san, size_t len) {
+  if (!game.error.empty())
+    return;
+
+  Move m = san_to_move(position, san, len);
+
+  if (m == MOVE_NONE) {
+    game.error = "cannot play '" + std::string(san, len) + "' at ply " +
+                 std::to_string(game.moves.size() + 1);
+    return;
+  }
+
+  game.moves.push_back(UCI::move(m, false));
+  states->emplace_back();
+  position.do_move(m, states->back());
+}
+
+/// next() reads tag pairs until the movetext starts, then moves until a game
+/// termination marker. A tag pair after some movetext also ends the game, so
+/// files with missing termination markers are read correctly.
+
+bool PgnReader::next(PgnGame &game) {
+  bool movetext = false;
+  char token[64];
+
+  game.clear();
+
+  while (true) {
+    skip_space();
+    int c = peek();
+
+    if (c == EOF)
+      break;
+
+    if (c == '[') {
+      if (movetext)
+        break;
+      get();
+      read_tag(game);
+      continue;
+    }
+
+    if (c == '%' || c == ';') {
+      skip_line();
+      continue;
+    }
+
+    if (c == '{') {
+      skip_comment();
+      continue;
+    }
+
+    if (c == '(') {
+      skip_variation();
+      continue;
+    }
+
+    if (c == '$' || c == ')' || c == ']' || c == '}') {
+      get();
+      read_token(token, sizeof(token)); // NAG number or stray text
+      continue;
+    }
+
+    if (!movetext) {
+      std::string fen = game.tag("FEN");
+
+      states = StateListPtr(new std::deque<StateInfo>(1));
+      // Not bound to any search thread: readers replay moves while it searches
+      position.set(fen.empty() ? StartFEN : fen, false, &states->back(),
+                   nullptr);
+      movetext = true;
+    }
+
+    size_t len = read_token(token, sizeof(token));
+
+    if (is_result(token)) {
+      game.result = token;
+      break;
+    }
+
+    // Move numbers: "12.", "12...", possibly glued to the move as "12.e4"
+    const char *san = token;
+    if (isdigit(*san) && strchr(token, '.')) {
+      while (isdigit(*san) || *san == '.')
+        ++san;
+      len -= san - token;
+    }
+
+    if (len)
+      play_move(game, san, len);
+  }
+
+  if (!movetext && game.tags.empty())
+    return false;
+
+  if (game.result.empty())
+    game.result = game.tag("Result");
+
+  ++game_count;
+  return true;
+}
@@ -0,0 +1,24 @@
+#include "pipeline.hpp"
+#include <iomanip>
+#include <sstream>
+
+std::string Stage::report() const {
+  std::stringstream ss;
+
+  ss << std::left << std::setw(8) << name << std::right << std::fixed
+     << std::setprecision(1) << "in: " << std::setw(9) << items_in
+     << "    out: " << std::setw(9) << items_out << "    " << std::setw(8)
+     << seconds << " s    " << std::setw(10)
+     << (seconds > 0 ? items_in / seconds : 0.0) << " /s";
+
+  return ss.str();
+}
+
+std::string report(const std::vector<const Stage *> &stages) {
+  std::string s;
+
+  for (const Stage *stage : stages)
+    s += (s.empty() ? "" : "\n") + stage->report();
+
+  return s;
+}
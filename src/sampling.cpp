@@ -0,0 +1,91 @@
+#include "sampling.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Standard normal CDF
+inline double phi(double x) { return 0.5 * std::erfc(-x / std::sqrt(2.0)); }
+
+} // namespace
+
+uint64_t Sampling::seed(uint64_t run_seed, uint64_t id) {
+  // SplitMix64 of the combined value, a good spread for consecutive ids
+  uint64_t z = run_seed + 0x9e3779b97f4a7c15ULL * (id + 1);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+
+  return z ? z : 1;
+}
+
+/// uniform() uses Floyd's algorithm: for j = n - k .. n - 1 draw t in [0, j]
+/// and take t, or j itself if t was already taken. Each j is larger than all
+/// the indices taken before it, so it goes at the back of the sorted output.
+
+void Sampling::uniform(PRNG &rng, unsigned n, unsigned k,
+                       std::vector<unsigned> &out) {
+  k = std::min(k, n);
+  size_t first = out.size();
+  out.reserve(first + k);
+
+  for (unsigned j = n - k; j < n; ++j) {
+    unsigned t = below(rng, j + 1);
+    auto it = std::lower_bound(out.begin() + first, out.end(), t);
+
+    if (it != out.end() && *it == t)
+      out.push_back(j);
+    else
+      out.insert(it, t);
+  }
+}
+
+void Sampling::normal(PRNG &rng, unsigned n, unsigned k, double mean,
+                      double stddev, std::vector<unsigned> &out) {
+  k = std::min(k, n);
+  size_t first = out.size();
+  out.reserve(first + k);
+
+  // CDF at the index boundaries i - 0.5, cached on the stack for games of
+  // usual length and recomputed on the fly beyond.
+  const unsigned Cached = 512;
+  double cached[Cached + 1];
+
+  auto cdf = [&](unsigned i) {
+    return i <= Cached && n <= Cached ? cached[i]
+                                      : phi((i - 0.5 - mean) / stddev);
+  };
+
+  if (n <= Cached)
+    for (unsigned i = 0; i <= n; ++i)
+      cached[i] = phi((i - 0.5 - mean) / stddev);
+
+  double total = cdf(n) - cdf(0);
+
+  for (unsigned drawn = 0; drawn < k; ++drawn) {
+    double u = uniform01(rng) * total;
+    auto taken = out.begin() + first;
+    unsigned index = n;
+    double mass = 0;
+
+    // Walk the indices not taken yet until their mass exceeds u
+    for (unsigned i = 0; i < n; ++i) {
+      if (taken != out.end() && *taken == i) {
+        ++taken;
+        continue;
+      }
+
+      mass = cdf(i + 1) - cdf(i);
+      index = i;
+
+      if (u < mass)
+        break;
+
+      u -= mass;
+    }
+
+    // Rounding may leave u past the last index, which is then taken
+    total -= mass;
+    out.insert(std::lower_bound(out.begin() + first, out.end(), index), index);
+  }
+}
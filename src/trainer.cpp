@@ -0,0 +1,144 @@
+#include "trainer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+Trainer::Trainer(MLP::Network &net, double learning_rate, double beta1,
+                 double beta2, unsigned mini_batch_size)
+    : net(net), learning_rate(learning_rate), beta1(beta1), beta2(beta2),
+      mini_batch_size(mini_batch_size), steps(0), generator(42) {
+
+  state.resize(net.layers.size());
+  acts.resize(net.layers.size() + 1);
+
+  for (unsigned l = 0; l < net.layers.size(); ++l) {
+    const MLP::Layer &layer = net.layers[l];
+
+    state[l].grad_w.assign(layer.weights.size(), 0.0f);
+    state[l].m_w = state[l].v_w = state[l].grad_w;
+    state[l].grad_b.assign(layer.biases.size(), 0.0f);
+    state[l].m_b = state[l].v_b = state[l].grad_b;
+    acts[l + 1].resize(layer.outputs);
+  }
+}
+
+/// backprop() runs one sample forward and accumulates its loss gradient into
+/// grad_w/grad_b. Activation derivatives are computed from the activations.
+
+double Trainer::backprop(const float *input, float label, float weight) {
+  acts[0].assign(input, input + net.inputs());
+
+  for (unsigned l = 0; l < net.layers.size(); ++l)
+    net.layers[l].forward(acts[l].data(), acts[l + 1].data());
+
+  float out = acts.back()[0];
+  double margin = label * out;
+  double loss = margin > 0 ? std::log1p(std::exp(-margin))
+                           : -margin + std::log1p(std::exp(margin));
+
+  delta.assign(1, float(-weight * label / (1.0 + std::exp(margin))));
+
+  for (int l = net.layers.size() - 1; l >= 0; --l) {
+    const MLP::Layer &layer = net.layers[l];
+    const std::vector<float> &a = acts[l + 1];
+    LayerState &s = state[l];
+
+    for (unsigned o = 0; o < layer.outputs; ++o) {
+      switch (layer.activation) {
+      case MLP::LINEAR:  break;
+      case MLP::HTAN:    delta[o] *= 1.0f - a[o] * a[o]; break;
+      case MLP::RELU:    delta[o] *= a[o] > 0.0f; break;
+      case MLP::SIGMOID: delta[o] *= a[o] * (1.0f - a[o]); break;
+      }
+      s.grad_b[o] += delta[o];
+    }
+
+    prev_delta.assign(layer.inputs, 0.0f);
+
+    for (unsigned i = 0; i < layer.inputs; ++i) {
+      const float x = acts[l][i];
+      const float *w = &layer.weights[i * layer.outputs];
+      float *g = &s.grad_w[i * layer.outputs];
+
+      for (unsigned o = 0; o < layer.outputs; ++o) {
+        g[o] += x * delta[o];
+        prev_delta[i] += w[o] * delta[o];
+      }
+    }
+
+    std::swap(delta, prev_delta);
+  }
+
+  return weight * loss;
+}
+
+void Trainer::step(unsigned batch_size) {
+  const double eps = 1e-8;
+  ++steps;
+
+  double lr = learning_rate * std::sqrt(1.0 - std::pow(beta2, steps)) /
+              (1.0 - std::pow(beta1, steps));
+
+  auto update = [&](std::vector<float> &param, std::vector<float> &grad,
+                    std::vector<float> &m, std::vector<float> &v) {
+    for (unsigned k = 0; k < param.size(); ++k) {
+      double g = grad[k] / batch_size;
+      m[k] = beta1 * m[k] + (1 - beta1) * g;
+      v[k] = beta2 * v[k] + (1 - beta2) * g * g;
+      param[k] -= lr * m[k] / (std::sqrt(v[k]) + eps);
+      grad[k] = 0.0f;
+    }
+  };
+
+  for (unsigned l = 0; l < net.layers.size(); ++l) {
+    update(net.layers[l].weights, state[l].grad_w, state[l].m_w, state[l].v_w);
+    update(net.layers[l].biases, state[l].grad_b, state[l].m_b, state[l].v_b);
+  }
+}
+
+double Trainer::train_batch(const std::vector<sample_type> &samples,
+                            const std::vector<float> &labels,
+                            const std::vector<float> &weights,
+                            const std::vector<unsigned> &indices) {
+  double loss = 0.0, weight_sum = 0.0;
+
+  for (unsigned i : indices) {
+    float weight = weights.empty() ? 1.0f : weights[i];
+
+    loss += backprop(&samples[i](0), labels[i], weight);
+    weight_sum += weight;
+  }
+
+  if (!indices.empty())
+    step(indices.size());
+
+  return weight_sum > 0 ? loss / weight_sum : 0.0;
+}
+
+double Trainer::train_epoch(const std::vector<sample_type> &samples,
+                            const std::vector<float> &labels,
+                            const std::vector<float> &weights) {
+  std::vector<unsigned> order(samples.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), generator);
+
+  double loss = 0.0, weight_sum = 0.0;
+  unsigned in_batch = 0;
+
+  for (unsigned i : order) {
+    float weight = weights.empty() ? 1.0f : weights[i];
+
+    loss += backprop(&samples[i](0), labels[i], weight);
+    weight_sum += weight;
+
+    if (++in_batch == mini_batch_size) {
+      step(in_batch);
+      in_batch = 0;
+    }
+  }
+
+  if (in_batch)
+    step(in_batch);
+
+  return weight_sum > 0 ? loss / weight_sum : 0.0;
+}
@@ -1,84 +1,11 @@
 #include "utils.hpp"
 #include "adapter.h"
+#include "sampling.hpp"
 #include <algorithm>
 #include <assert.h>
-#include <random>
-#include <set>
 #include <sstream>
 #include <vector>
 
-std::normal_distribution<double>
-Utils::generate_normal_distribution(unsigned num_elements) {
-  unsigned stdcover = 1;
-  /* 'stdcover' = how many standard deviations are covered in half the number of
-   * moves Higher the value of stdcover, lower the probability of starting and
-   * ending moves getting picked.
-   * */
-  double mean, stddev;
-  double _num_elements = (double)num_elements;
-  mean = (_num_elements - 1) / 2;
-  stddev = (_num_elements / 2) / stdcover;
-  return std::normal_distribution<double>(mean, stddev);
-}
-
-template <typename T>
-std::vector<unsigned> _sample_indices(T distribution, unsigned num_elements,
-                                      unsigned num_samples) {
-
-  if (num_samples > num_elements) {
-    num_samples = num_elements;
-  }
-
-  unsigned index;
-  double ulimit, llimit, number, fn, cn;
-  std::set<unsigned> indexes;
-
-  /* Example to illustrate the idea.
-   * If num_elements is 3.
-   * llimit = -0.5, ulimit = 2.5
-   * (-0.5, 0.5) -> 0
-   * ( 0.5, 1.5) -> 1
-   * ( 1.5, 2.5) -> 2
-   */
-  std::default_random_engine generator;
-  generator.seed(42);
-  llimit = -0.5, ulimit = num_elements - 0.5;
-
-  while (num_samples) {
-    /* sample from distribution and get index */
-    do {
-      number = distribution(generator);
-    } while (number <= llimit || number >= ulimit);
-
-    fn = floor(number);
-    cn = ceil(number);
-    index = ((cn - number) < (number - fn)) ? cn : fn;
-
-    /* no repetetion of indices */
-    if (indexes.find(index) != indexes.end())
-      continue;
-
-    indexes.insert(index);
-    num_samples -= 1;
-  }
-
-  return std::vector<unsigned>(indexes.begin(), indexes.end());
-}
-
-template <>
-std::vector<unsigned>
-Utils::sample_indices(std::normal_distribution<double> distribution,
-                      unsigned num_elements, unsigned num_samples) {
-  return _sample_indices(distribution, num_elements, num_samples);
-}
-
-template <>
-std::vector<unsigned>
-Utils::sample_indices(std::uniform_int_distribution<int> distribution,
-                      unsigned num_elements, unsigned num_samples) {
-  return _sample_indices(distribution, num_elements, num_samples);
-}
-
 std::string Utils::uci_init_moves_cmd(std::vector<std::string> moves) {
   std::string cmd = "position fen "
                     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 "
@@ -145,3 +72,92 @@ Utils::get_alt_moves(std::vector<std::string> init_moves, std::string move) {
 
   return alt_moves;
 }
+
+/// select_alt_moves() asks the engine for every legal move with its static
+/// exchange verdict and its MultiPV rank. The played move takes one of the
+/// k + 1 searched slots when it is among the best, so k alternatives are
+/// kept whenever there are that many. If the SEE filter would drop every
+/// alternative, it is not applied.
+
+std::vector<std::string>
+Utils::select_alt_moves(std::vector<std::string> init_moves, std::string move,
+                        const AltSelection &selection, PRNG &rng) {
+  unsigned multipv = selection.top_k ? selection.top_k + 1 : 0;
+  std::vector<std::string> uci_commands{
+      Utils::uci_init_moves_cmd(init_moves),
+      "rankmoves " + std::to_string(multipv ? selection.depth : 0) + " " +
+          std::to_string(multipv)};
+
+  auto uci_output_lines = Adapter::run_uci_commands(uci_commands);
+
+  struct Ranked {
+    std::string move;
+    bool see;
+    int rank;
+  };
+  std::vector<Ranked> all, kept;
+
+  for (auto line : uci_output_lines) {
+    std::stringstream ss(line);
+    Ranked r;
+    std::string see, rank;
+
+    if ((ss >> r.move >> see >> r.see >> rank >> r.rank) && see == "see" &&
+        r.move != move)
+      all.push_back(r);
+  }
+
+  for (const Ranked &r : all)
+    if (!selection.see || r.see)
+      kept.push_back(r);
+
+  if (kept.empty())
+    kept = all;
+
+  if (!selection.top_k) {
+    std::vector<std::string> alt_moves;
+    for (const Ranked &r : kept)
+      alt_moves.push_back(r.move);
+    return alt_moves;
+  }
+
+  std::vector<std::string> alt_moves, rest;
+  std::stable_sort(kept.begin(), kept.end(), [](const Ranked &a, const Ranked &b) {
+    return unsigned(a.rank) < unsigned(b.rank); // -1 sorts last
+  });
+
+  for (const Ranked &r : kept)
+    if (r.rank >= 0 && alt_moves.size() < selection.top_k)
+      alt_moves.push_back(r.move);
+    else
+      rest.push_back(r.move);
+
+  // Partial Fisher-Yates over the remaining moves
+  for (unsigned i = 0; i < selection.random_tail && i < rest.size(); ++i) {
+    std::swap(rest[i], rest[i + Sampling::below(rng, rest.size() - i)]);
+    alt_moves.push_back(rest[i]);
+  }
+
+  return alt_moves;
+}
+
+ScreenInfo Utils::screen(std::vector<std::string> init_moves, unsigned depth) {
+  std::vector<std::string> uci_commands{Utils::uci_init_moves_cmd(init_moves),
+                                        "screen " + std::to_string(depth)};
+
+  auto uci_output_lines = Adapter::run_uci_commands(uci_commands);
+  ScreenInfo info;
+
+  for (auto line : uci_output_lines) {
+    if (line.compare(0, 7, "screen ") != 0)
+      continue;
+
+    std::stringstream ss(line);
+    std::string token;
+
+    ss >> token >> token >> info.legal_moves >> token >> info.checkers >>
+        token >> info.after_capture >> token >> info.spread;
+  }
+
+  return info;
+}
@@ -0,0 +1,69 @@
+#include "catch.hpp"
+#include "checkpoint.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+std::string read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+TEST_CASE("checkpoint::save_load", "checkpoint") {
+  const std::string path = "checkpoint_test.ckpt";
+
+  Checkpoint saved;
+  saved.input = "games dir/corpus.pgn";
+  saved.input_size = 5000000000ull;
+  saved.offset = 4000000000ull;
+  saved.skip = 3;
+  saved.games = 123456;
+  saved.last_id = 654321;
+  saved.shard = 2;
+  saved.shard_bytes = 777;
+
+  REQUIRE(saved.save(path));
+  REQUIRE(read_file(path + ".tmp").empty());
+
+  Checkpoint loaded;
+  REQUIRE(loaded.load(path));
+  REQUIRE(loaded.input == saved.input);
+  REQUIRE(loaded.input_size == saved.input_size);
+  REQUIRE(loaded.offset == saved.offset);
+  REQUIRE(loaded.skip == saved.skip);
+  REQUIRE(loaded.games == saved.games);
+  REQUIRE(loaded.last_id == saved.last_id);
+  REQUIRE(loaded.shard == saved.shard);
+  REQUIRE(loaded.shard_bytes == saved.shard_bytes);
+
+  // Saving again replaces the checkpoint
+  saved.shard = 3;
+  REQUIRE(saved.save(path));
+  REQUIRE(loaded.load(path));
+  REQUIRE(loaded.shard == 3);
+
+  std::ofstream(path) << "checkpoint 0" << std::endl;
+  REQUIRE(!loaded.load(path));
+
+  std::remove(path.c_str());
+  REQUIRE(!loaded.load(path));
+
+  REQUIRE(Checkpoint::shard_path("out.csv", 0) == "out.csv");
+  REQUIRE(Checkpoint::shard_path("out.csv", 2) == "out.csv.2");
+}
+
+TEST_CASE("checkpoint::truncate_file", "checkpoint") {
+  const std::string path = "checkpoint_test.csv";
+
+  std::ofstream(path, std::ios::binary) << "1,2,Left\n3,4,Ri";
+  REQUIRE(truncate_file(path, 9));
+  REQUIRE(read_file(path) == "1,2,Left\n");
+
+  std::remove(path.c_str());
+  REQUIRE(!truncate_file(path, 0));
+}
@@ -0,0 +1,152 @@
+#include "catch.hpp"
+#include "columnar.hpp"
+#include "data_io.hpp"
+#include <sstream>
+
+TEST_CASE("columnar::encode", "columnar") {
+  std::vector<std::vector<int32_t>> columns = {
+      {},
+      {0, 0, 0, 0},
+      {-3, 2, 1, -1, 0, 3},
+      {7, -7, 7, -7, 7},
+      {1000000, 1000001, 1000002, 1000003},
+      {INT32_MIN, INT32_MAX, 0, -1},
+      {0, 0, 0, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -9, 0, 0, 0, 0, 0, 0, 0, 0}};
+
+  for (const auto &values : columns) {
+    std::string data;
+    Columnar::ColumnStats s = Columnar::encode(values, data);
+
+    REQUIRE(s.bytes == data.size());
+
+    std::vector<int32_t> decoded;
+    Columnar::decode(s, data.data(), values.size(), decoded);
+    REQUIRE(decoded == values);
+  }
+
+  std::string data;
+  Columnar::ColumnStats s = Columnar::encode({0, 0, 0, 0}, data);
+  REQUIRE(s.encoding == Columnar::BITPACK);
+  REQUIRE(s.width == 0);
+  REQUIRE(s.bytes == 0);
+
+  data.clear();
+  s = Columnar::encode({1000000, 1000001, 1000002, 1000003}, data);
+  REQUIRE(s.encoding == Columnar::BITPACK);
+  REQUIRE(s.width == 2);
+  REQUIRE(s.min == 1000000);
+  REQUIRE(s.max == 1000003);
+  REQUIRE(s.nonzero == 4);
+
+  data.clear();
+  s = Columnar::encode({0, 0, 0, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -9, 0, 0, 0,
+                        0, 0, 0, 0, 0},
+                       data);
+  REQUIRE(s.encoding == Columnar::SPARSE);
+  REQUIRE(s.nonzero == 2);
+
+  // Stats or data that do not match are rejected
+  std::vector<int32_t> decoded;
+  REQUIRE(!Columnar::decode(s, data.data(), 10, decoded));
+  s.bytes = 2;
+  REQUIRE(!Columnar::decode(s, data.data(), 23, decoded));
+  s.encoding = Columnar::BITPACK;
+  s.width = 33;
+  REQUIRE(!Columnar::decode(s, data.data(), 0, decoded));
+}
+
+TEST_CASE("columnar::corrupt", "columnar") {
+  std::stringstream good;
+  {
+    Columnar::Writer writer(good, {"a", "b"});
+    writer.push_back({1, -2}, 0, 1.0f, 1);
+    writer.push_back({2, 0}, 1, 1.0f, -1);
+    writer.push_back({3, 7}, 2, 0.5f, 1);
+  }
+
+  // magic, version, hash, count, names / row count, mirrored flag
+  const size_t block = 8 + 4 + 8 + 4 + 2 * 3, stats = block + 4 + 1;
+  const size_t stats_size = 2 + 4 * 4;
+
+  auto read = [](const std::string &bytes, bool &good) {
+    std::stringstream in(bytes);
+    SampleSet<sample_type> set;
+    Columnar::Reader reader(in);
+    unsigned blocks = 0;
+
+    while (reader.next(set))
+      ++blocks;
+
+    good = reader.good();
+    return blocks;
+  };
+
+  bool ok;
+  REQUIRE(read(good.str(), ok) == 1);
+  REQUIRE(ok);
+
+  // Truncated block
+  std::string bytes = good.str();
+  REQUIRE(read(bytes.substr(0, bytes.size() - 1), ok) == 0);
+  REQUIRE(!ok);
+
+  // Bit width of the first column
+  bytes[stats + 1] = 33;
+  REQUIRE(read(bytes, ok) == 0);
+  REQUIRE(!ok);
+
+  // Size of the second column (the last field of its stats), as if it ran
+  // past the block
+  bytes = good.str();
+  bytes[stats + 2 * stats_size - 1] = 0x7F;
+  REQUIRE(read(bytes, ok) == 0);
+  REQUIRE(!ok);
+}
+
+TEST_CASE("columnar::convert", "columnar") {
+  const FeatureSchema::Descriptor &cur = FeatureSchema::current();
+  std::stringstream csv;
+
+  csv << FeatureSchema::csv_comment(cur) << std::endl
+      << FeatureSchema::csv_header(cur) << std::endl;
+
+  // Rows 0 to 7 are Left / Right pairs, rows 8 and 9 are not
+  auto value = [](size_t f, int r) {
+    int v = int(f % 5) - 2 + r / 2;
+    return r < 8 && r % 2 ? -v : v;
+  };
+
+  for (int r = 0; r < 10; ++r) {
+    for (size_t f = 0; f < cur.names.size(); ++f)
+      csv << value(f, r) << ',';
+    csv << r / 2 << ',' << (r / 2 == 3 ? 0.5 : 1) << ','
+        << (r % 2 ? "Right" : "Left") << std::endl;
+  }
+
+  std::stringstream col;
+  REQUIRE(Columnar::convert(csv, col, 4) == 10);
+  REQUIRE(Columnar::is_columnar(col));
+
+  SampleSet<sample_type> set;
+  Columnar::Reader reader(col);
+  REQUIRE(reader.good());
+  REQUIRE(reader.names() == cur.names);
+
+  // Only the second feature is decoded
+  reader.project({cur.names[1]});
+
+  unsigned blocks = 0;
+  while (reader.next(set))
+    ++blocks;
+
+  REQUIRE(blocks == 3);
+  REQUIRE(set.size() == 10);
+
+  for (int r = 0; r < 10; ++r) {
+    REQUIRE(set.samples[r](0) == 0);
+    REQUIRE(set.samples[r](1) == value(1, r));
+    REQUIRE(set.phases[r] == r / 2);
+    REQUIRE(set.weights[r] == (r / 2 == 3 ? 0.5f : 1.0f));
+    REQUIRE(set.labels[r] == (r % 2 ? -1 : 1));
+  }
+}
@@ -0,0 +1,61 @@
+#include "catch.hpp"
+#include "dedup.hpp"
+#include <random>
+
+TEST_CASE("dedup::keyset", "dedup") {
+  KeySet set(4);
+  std::mt19937_64 rng(1);
+  std::vector<uint64_t> keys{0};
+
+  for (int i = 0; i < 1000; ++i)
+    keys.push_back(rng());
+
+  for (uint64_t k : keys)
+    REQUIRE(set.insert(k));
+
+  for (uint64_t k : keys)
+    REQUIRE(!set.insert(k));
+
+  REQUIRE(set.size() == keys.size());
+}
+
+TEST_CASE("dedup::bloom", "dedup") {
+  BloomFilter bloom(10000, 0.01);
+  std::mt19937_64 rng(1);
+  std::vector<uint64_t> keys;
+
+  for (int i = 0; i < 10000; ++i)
+    keys.push_back(rng());
+
+  unsigned inserted = 0;
+  for (uint64_t k : keys)
+    inserted += bloom.insert(k);
+
+  for (uint64_t k : keys)
+    REQUIRE(!bloom.insert(k));
+
+  // At most a few percent of new keys collide at the target false positive rate
+  REQUIRE(inserted > 9800);
+  REQUIRE(std::abs(bloom.cardinality() - 10000) < 500);
+}
+
+TEST_CASE("dedup::pairs", "dedup") {
+  Dedup dedup(Dedup::EXACT, 16);
+
+  REQUIRE(dedup.insert(1, 2));
+  REQUIRE(dedup.insert(2, 1));
+  REQUIRE(!dedup.insert(1, 2));
+  REQUIRE(dedup.insert(1, 3));
+
+  Dedup none(Dedup::NONE);
+
+  REQUIRE(none.insert(1, 2));
+  REQUIRE(none.insert(1, 2));
+}
+
+TEST_CASE("dedup::mode_from_name", "dedup") {
+  REQUIRE(Dedup::mode_from_name("none") == Dedup::NONE);
+  REQUIRE(Dedup::mode_from_name("exact") == Dedup::EXACT);
+  REQUIRE(Dedup::mode_from_name("bloom") == Dedup::BLOOM);
+  REQUIRE_THROWS(Dedup::mode_from_name("Exact"));
+}
@@ -0,0 +1,70 @@
+#include "catch.hpp"
+#include "featschema.h"
+#include <dlib/serialize.h>
+#include <sstream>
+
+TEST_CASE("featschema::names", "featschema") {
+  const FeatureSchema::Descriptor &d = FeatureSchema::current();
+
+  REQUIRE(d.names.size() == FEATURE_COUNT);
+  REQUIRE(FeatureSchema::name(BISHOP__MINOR_BEHIND_PAWN) ==
+          "BISHOP__MINOR_BEHIND_PAWN");
+  REQUIRE(FeatureSchema::name(MATERIAL__PAWN) == "MATERIAL__PAWN");
+  REQUIRE(FeatureSchema::name(THREATS__THREAT_BY_ROOK_RANK) ==
+          "THREATS__THREAT_BY_ROOK_RANK");
+}
+
+TEST_CASE("featschema::hash", "featschema") {
+  std::vector<std::string> names{"A", "B", "C"};
+  std::vector<std::string> swapped{"B", "A", "C"};
+  std::vector<std::string> merged{"AB", "C"};
+
+  REQUIRE(FeatureSchema::hash(names) == FeatureSchema::hash(names));
+  REQUIRE(FeatureSchema::hash(names) != FeatureSchema::hash(swapped));
+  REQUIRE(FeatureSchema::hash(names) != FeatureSchema::hash(merged));
+}
+
+TEST_CASE("featschema::remap", "featschema") {
+  std::vector<std::string> from{"A", "B", "C"};
+  std::vector<std::string> to{"C", "D", "A"};
+
+  REQUIRE(FeatureSchema::remap(from, to) == (std::vector<int>{2, -1, 0}));
+}
+
+TEST_CASE("featschema::csv_comment", "featschema") {
+  const FeatureSchema::Descriptor &d = FeatureSchema::current();
+  std::string comment = FeatureSchema::csv_comment(d);
+
+  uint64_t hash;
+  unsigned count;
+
+  REQUIRE(FeatureSchema::is_csv_comment(comment));
+  REQUIRE(FeatureSchema::from_csv_comment(comment, hash, count));
+  REQUIRE(hash == d.hash);
+  REQUIRE(count == FEATURE_COUNT);
+  REQUIRE(!FeatureSchema::is_csv_comment(FeatureSchema::csv_header(d)));
+}
+
+TEST_CASE("featschema::serialize", "featschema") {
+  FeatureSchema::Descriptor d;
+  d.names = {"A", "B"};
+  d.hash = FeatureSchema::hash(d.names);
+
+  std::stringstream ss;
+  FeatureSchema::serialize(d, ss);
+  dlib::serialize(42, ss);
+
+  FeatureSchema::Descriptor loaded;
+  REQUIRE(FeatureSchema::deserialize(loaded, ss));
+  REQUIRE(loaded.names == d.names);
+  REQUIRE(loaded == d);
+
+  // Legacy streams carry no schema and must be left untouched
+  std::stringstream legacy;
+  dlib::serialize(42, legacy);
+
+  int value;
+  REQUIRE(!FeatureSchema::deserialize(loaded, legacy));
+  dlib::deserialize(value, legacy);
+  REQUIRE(value == 42);
+}
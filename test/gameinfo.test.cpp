@@ -0,0 +1,69 @@
+#include "catch.hpp"
+#include "gameinfo.hpp"
+#include <algorithm>
+#include <sstream>
+
+TEST_CASE("gameinfo::filter", "gameinfo") {
+  GameRecord game;
+  game.result = WHITE_WON;
+  game.white_elo = 2500;
+  game.black_elo = 2300;
+  game.moves.assign(40, "e2e4");
+
+  GameFilter filter;
+  REQUIRE(filter.accept(game));
+
+  filter.min_elo = 2400;
+  REQUIRE(!filter.accept(game));
+  filter.min_elo = 2300;
+  REQUIRE(filter.accept(game));
+
+  filter.min_ply = 41;
+  REQUIRE(!filter.accept(game));
+  filter.min_ply = 0;
+  filter.max_ply = 39;
+  REQUIRE(!filter.accept(game));
+  filter.max_ply = 40;
+  REQUIRE(filter.accept(game));
+
+  game.result = DRAW;
+  REQUIRE(!filter.accept(game));
+
+  filter.set_results("1/2-1/2");
+  REQUIRE(filter.accept(game));
+  game.result = BLACK_WON;
+  REQUIRE(!filter.accept(game));
+
+  REQUIRE_THROWS(filter.set_results("1-0,2-0"));
+}
+
+TEST_CASE("gameinfo::screened", "gameinfo") {
+  // Black is in check before each of its last four moves, so only the
+  // positions before its first two moves (plies 2 and 4) can be sampled
+  GameRecord record;
+  record.id = 1;
+  record.result = BLACK_WON;
+  record.moves = {"e2e4", "e7e6", "d2d4", "e8e7", "c1g5", "e7d6",
+                  "e4e5", "d6d5", "d1f3", "d5d4", "f3e3", "d4d5"};
+
+  TrainGame game;
+  game.move_strategy = SCREENED;
+  game.screen_depth = 2;
+  game.alt_selection.top_k = 1;
+  game.alt_selection.depth = 2;
+
+  for (uint64_t seed = 1; seed <= 3; ++seed) {
+    game.seed = seed;
+    REQUIRE(game.expand(record));
+
+    auto lines = game.to_lines();
+    auto it = std::find(lines.begin(), lines.end(), "SampledWinnerMoves");
+    REQUIRE(it + 2 < lines.end());
+    REQUIRE(*(it + 2) == "SampledMoveBranches");
+
+    std::stringstream ss(*(it + 1));
+    unsigned ply = 0;
+    ss >> ply;
+    REQUIRE((ply == 2 || ply == 4));
+  }
+}
@@ -0,0 +1,96 @@
+#include "catch.hpp"
+#include "ingest.hpp"
+#include "io.hpp"
+#include <sstream>
+
+namespace {
+
+std::string pgn_games(unsigned count) {
+  std::string text;
+
+  for (unsigned i = 0; i < count; ++i)
+    text += "[Event \"Game " + std::to_string(i) + "\"]\n[Result \"1-0\"]\n\n" +
+            (i % 2 ? "1. e4 e5 2. Nf3 1-0\n\n" : "1. d4 {[Event x]} d5 1-0\n\n");
+
+  return text;
+}
+
+std::string line_games(unsigned count) {
+  std::string text;
+
+  for (unsigned i = 0; i < count; ++i)
+    text += "GameId        " + std::to_string(i + 1) +
+            "\nResult        0-1\nWhiteElo        2600\nMoves\n"
+            "  1        e2e4\n  2                    e7e5\n" +
+            GAME_END + "\n";
+
+  return text;
+}
+
+} // namespace
+
+TEST_CASE("ingest::split_chunks", "ingest") {
+  std::string text = pgn_games(50);
+  auto chunks = split_chunks(text.data(), text.size(), 100, true);
+
+  REQUIRE(chunks.size() > 1);
+  REQUIRE(chunks.front().first == 0);
+
+  size_t next = 0;
+  for (auto c : chunks) {
+    REQUIRE(c.first == next);
+    REQUIRE(text.compare(c.first, 7, "[Event ") == 0);
+    next = c.first + c.second;
+  }
+  REQUIRE(next == text.size());
+
+  text = line_games(50);
+  chunks = split_chunks(text.data(), text.size(), 100, false);
+
+  REQUIRE(chunks.size() == 50);
+  for (auto c : chunks)
+    REQUIRE(text.compare(c.first, 7, "GameId ") == 0);
+}
+
+TEST_CASE("ingest::order", "ingest") {
+  for (unsigned threads : {1, 4}) {
+    IngestOptions options;
+    options.threads = threads;
+    options.chunk_size = 64;
+    options.window = 3;
+
+    std::string text = pgn_games(200);
+    Ingest ingest(text.data(), text.size(), options);
+    PgnGame game;
+
+    for (unsigned i = 0; i < 200; ++i) {
+      REQUIRE(ingest.next(game));
+      REQUIRE(game.tag("Event") == "Game " + std::to_string(i));
+      REQUIRE(game.moves.size() == (i % 2 ? 3 : 2));
+      REQUIRE(game.result == "1-0");
+    }
+
+    REQUIRE(!ingest.next(game));
+    REQUIRE(ingest.games() == 200);
+    REQUIRE(ingest.bytes() == text.size());
+  }
+}
+
+TEST_CASE("ingest::game_lines", "ingest") {
+  std::string text = line_games(20);
+  IngestOptions options;
+  options.chunk_size = 128;
+
+  Ingest ingest(text.data(), text.size(), options);
+  PgnGame game;
+
+  for (unsigned i = 0; i < 20; ++i) {
+    REQUIRE(ingest.next(game));
+    REQUIRE(game.tag("GameId") == std::to_string(i + 1));
+    REQUIRE(game.tag("WhiteElo") == "2600");
+    REQUIRE(game.result == "0-1");
+    REQUIRE(game.moves == (std::vector<std::string>{"e2e4", "e7e5"}));
+  }
+
+  REQUIRE(!ingest.next(game));
+}
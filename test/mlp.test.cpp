@@ -0,0 +1,152 @@
+#include "catch.hpp"
+#include "mlp.h"
+#include "trainer.hpp"
+#include <cmath>
+#include <sstream>
+
+namespace {
+// Straightforward reference forward pass used to check the kernels
+float reference(const MLP::Network &net, std::vector<float> x) {
+  for (const MLP::Layer &l : net.layers) {
+    std::vector<float> y(l.biases);
+
+    for (unsigned o = 0; o < l.outputs; ++o) {
+      for (unsigned i = 0; i < l.inputs; ++i)
+        y[o] += x[i] * l.weights[i * l.outputs + o];
+
+      if (l.activation == MLP::HTAN)
+        y[o] = std::tanh(y[o]);
+      else if (l.activation == MLP::RELU)
+        y[o] = std::max(y[o], 0.0f);
+    }
+    x = y;
+  }
+  return x[0];
+}
+} // namespace
+
+TEST_CASE("mlp::topology", "mlp") {
+  MLP::Network net(10, "32:relu,7:htan,1:linear");
+
+  REQUIRE(net.inputs() == 10);
+  REQUIRE(net.layers.size() == 3);
+  REQUIRE(net.topology() == "32:relu,7:htan,1:linear");
+  REQUIRE_THROWS(MLP::Network(10, "32:relu"));
+  REQUIRE_THROWS(MLP::Network(10, "32:foo,1:linear"));
+}
+
+TEST_CASE("mlp::evaluate", "mlp") {
+  // 32 uses a specialized kernel, 7 the generic one
+  MLP::Network net(10, "32:relu,7:htan,1:linear");
+
+  for (MLP::Layer &l : net.layers)
+    for (float &b : l.biases)
+      b = 0.1f;
+
+  std::vector<float> x{1, -2, 0, 3, 0, 0, -1, 2, 0, 1};
+
+  REQUIRE(std::abs(net.evaluate(x.data()) - reference(net, x)) < 1e-5);
+}
+
+TEST_CASE("mlp::evaluate_sparse", "mlp") {
+  for (std::string topology : {"32:relu,1:linear", "7:htan,1:linear"}) {
+    MLP::Network net(40, topology);
+    std::vector<float> x(40, 0.0f);
+    std::vector<unsigned> nonzero{0, 3, 17, 39};
+
+    for (unsigned i : nonzero)
+      x[i] = float(i) - 10.0f;
+
+    float dense = net.evaluate(x.data());
+    float sparse = net.evaluate(x.data(), nonzero.data(), nonzero.size());
+
+    REQUIRE(std::abs(dense - sparse) < 1e-5);
+    REQUIRE(std::abs(dense - reference(net, x)) < 1e-5);
+  }
+}
+
+TEST_CASE("mlp::serialize", "mlp") {
+  MLP::Network net(5, "8:htan,1:linear"), loaded;
+  std::vector<float> x{1, 2, 3, 4, 5};
+
+  std::stringstream ss;
+  MLP::serialize(net, ss);
+
+  REQUIRE(MLP::deserialize(loaded, ss));
+  REQUIRE(loaded.topology() == net.topology());
+  REQUIRE(loaded.evaluate(x.data()) == net.evaluate(x.data()));
+
+  std::stringstream other;
+  dlib::serialize(42, other);
+  REQUIRE(!MLP::deserialize(loaded, other));
+}
+
+TEST_CASE("mlp::train", "mlp") {
+  MLP::Network net(2, "8:htan,1:linear");
+  Trainer trainer(net, 1e-2);
+
+  std::vector<sample_type> samples;
+  std::vector<float> labels;
+
+  for (int i = -5; i <= 5; ++i)
+    for (int j = -5; j <= 5; ++j)
+      if (i != j) {
+        sample_type s(2);
+        s(0) = i, s(1) = j;
+        samples.push_back(s);
+        labels.push_back(i > j ? +1 : -1);
+      }
+
+  double first = trainer.train_epoch(samples, labels), last = first;
+  for (int e = 0; e < 50; ++e)
+    last = trainer.train_epoch(samples, labels);
+
+  REQUIRE(last < first);
+
+  for (unsigned k = 0; k < samples.size(); ++k)
+    REQUIRE(net.evaluate(&samples[k](0)) * labels[k] > 0);
+}
+
+TEST_CASE("mlp::train_weights", "mlp") {
+  MLP::Network net(2, "8:htan,1:linear");
+  const std::vector<float> initial = net.layers[0].weights;
+  Trainer trainer(net, 1e-2);
+
+  std::vector<sample_type> samples(4, sample_type(2));
+  std::vector<float> labels{+1, -1, +1, -1};
+
+  for (unsigned k = 0; k < samples.size(); ++k)
+    samples[k](0) = k, samples[k](1) = 1;
+
+  // Zero weight samples do not move the network
+  trainer.train_epoch(samples, labels, std::vector<float>(4, 0.0f));
+  REQUIRE(net.layers[0].weights == initial);
+
+  trainer.train_epoch(samples, labels, std::vector<float>(4, 1.0f));
+  REQUIRE(net.layers[0].weights != initial);
+}
+
+TEST_CASE("mlp::train_batch", "mlp") {
+  MLP::Network net(2, "8:htan,1:linear");
+  Trainer trainer(net, 1e-2);
+
+  std::vector<sample_type> samples(4, sample_type(2));
+  std::vector<float> labels{+1, -1, +1, -1};
+  std::vector<float> weights(4, 1.0f);
+  std::vector<unsigned> indices{0, 1, 2, 3};
+
+  samples[0](0) = 2, samples[0](1) = 1;
+  samples[1](0) = -2, samples[1](1) = 1;
+  samples[2](0) = 1, samples[2](1) = -1;
+  samples[3](0) = -1, samples[3](1) = -1;
+
+  double first = trainer.train_batch(samples, labels, weights, indices);
+  double last = first;
+  for (int s = 0; s < 200; ++s)
+    last = trainer.train_batch(samples, labels, weights, indices);
+
+  REQUIRE(last < first);
+
+  for (unsigned k = 0; k < samples.size(); ++k)
+    REQUIRE(net.evaluate(&samples[k](0)) * labels[k] > 0);
+}
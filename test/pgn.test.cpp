@@ -0,0 +1,77 @@
+#include "adapter.h"
+#include "catch.hpp"
+#include "pgn.hpp"
+#include "thread.h"
+#include "uci.h"
+#include <sstream>
+
+namespace {
+const std::string PGN =
+    "[Event \"Test \\\"quoted\\\"\"]\n"
+    "[WhiteElo \"2500\"]\n"
+    "[Result \"1-0\"]\n"
+    "\n"
+    "1. e4 {comment (with a paren} e5 2. Nf3 (2. f4 exf4 (2... d5)) Nc6 $1\n"
+    "3. Bb5 a6 4.Ba4 Nf6 5. O-O Be7 6. Re1 b5 7. Bb3 d6 8. c3 O-O ; eol\n"
+    "1-0\n"
+    "\n"
+    "[Event \"Promotion\"]\n"
+    "[FEN \"8/P7/8/8/8/8/8/k6K w - - 0 1\"]\n"
+    "\n"
+    "1. a8=Q+ Kb2 2. Qb7+!? *\n"
+    "[Event \"Illegal\"]\n"
+    "1. e5 e5 0-1\n";
+
+const std::vector<std::string> FIRST{
+    "e2e4", "e7e5", "g1f3", "b8c6", "f1b5", "a7a6", "b5a4", "g8f6",
+    "e1g1", "f8e7", "f1e1", "b7b5", "a4b3", "d7d6", "c2c3", "e8g8"};
+} // namespace
+
+TEST_CASE("pgn::reader", "pgn") {
+  // Small buffers exercise tokens and comments straddling refills
+  for (size_t buffer_size : {7, 64, 1 << 16}) {
+    std::stringstream ss(PGN);
+    PgnReader reader(ss, buffer_size);
+    PgnGame game;
+
+    REQUIRE(reader.next(game));
+    REQUIRE(game.error.empty());
+    REQUIRE(game.tag("Event") == "Test \"quoted\"");
+    REQUIRE(game.tag("WhiteElo") == "2500");
+    REQUIRE(game.result == "1-0");
+    REQUIRE(game.moves == FIRST);
+
+    REQUIRE(reader.next(game));
+    REQUIRE(game.error.empty());
+    REQUIRE(game.result == "*");
+    REQUIRE(game.moves == (std::vector<std::string>{"a7a8q", "a1b2", "a8b7"}));
+
+    REQUIRE(reader.next(game));
+    REQUIRE(!game.error.empty());
+    REQUIRE(game.result == "0-1");
+
+    REQUIRE(!reader.next(game));
+    REQUIRE(reader.games() == 3);
+    REQUIRE(reader.bytes() == PGN.size());
+  }
+}
+
+TEST_CASE("pgn::san_to_move", "pgn") {
+  Adapter::init();
+
+  StateInfo st;
+  Position pos;
+  pos.set("4k3/8/8/8/8/8/4P3/1N2KN2 w - - 0 1", false, &st, Threads.main());
+
+  auto uci = [&](const std::string &san) {
+    Move m = san_to_move(pos, san.c_str(), san.size());
+    return m == MOVE_NONE ? std::string("none") : UCI::move(m, false);
+  };
+
+  REQUIRE(uci("Nbd2") == "b1d2");
+  REQUIRE(uci("Nfd2") == "f1d2");
+  REQUIRE(uci("Nd2") == "none"); // Ambiguous
+  REQUIRE(uci("e4") == "e2e4");
+  REQUIRE(uci("e5") == "none");
+  REQUIRE(uci("Kd1") == "e1d1");
+}
@@ -0,0 +1,18 @@
+#include "catch.hpp"
+#include "poscomp.h"
+
+TEST_CASE("poscomp::bucket", "poscomp") {
+  CompModel model;
+
+  REQUIRE(model.bucket(PHASE_ENDGAME) == 0);
+  REQUIRE(model.bucket(PHASE_MIDGAME) == 0);
+
+  model.bounds = {42, 85};
+
+  REQUIRE(model.bucket(PHASE_ENDGAME) == 0);
+  REQUIRE(model.bucket(42) == 0);
+  REQUIRE(model.bucket(43) == 1);
+  REQUIRE(model.bucket(85) == 1);
+  REQUIRE(model.bucket(PHASE_MIDGAME) == 2);
+  REQUIRE(model.bucket(-1) == 2);
+}
@@ -0,0 +1,73 @@
+#include "catch.hpp"
+#include "queue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("queue::bounded", "queue") {
+  BoundedQueue<int> queue(5);
+  int v;
+
+  REQUIRE(queue.capacity() == 8);
+  REQUIRE(!queue.try_pop(v));
+
+  for (int i = 0; i < 8; ++i)
+    REQUIRE(queue.try_push(int(i)));
+
+  REQUIRE(!queue.try_push(8));
+  REQUIRE(queue.size() == 8);
+
+  for (int i = 0; i < 8; ++i) {
+    REQUIRE(queue.try_pop(v));
+    REQUIRE(v == i);
+  }
+
+  REQUIRE(!queue.try_pop(v));
+}
+
+TEST_CASE("queue::threads", "queue") {
+  const int producers = 4, consumers = 3, per_producer = 100000;
+  BoundedQueue<int> queue(64);
+  std::atomic<int> left(producers * per_producer);
+  std::vector<std::vector<int>> seen(consumers);
+  std::vector<std::thread> threads;
+
+  for (int p = 0; p < producers; ++p)
+    threads.emplace_back([&, p]() {
+      for (int i = 0; i < per_producer; ++i)
+        while (!queue.try_push(p * per_producer + i))
+          std::this_thread::yield();
+    });
+
+  for (int c = 0; c < consumers; ++c)
+    threads.emplace_back([&, c]() {
+      int v;
+      while (left > 0)
+        if (queue.try_pop(v)) {
+          seen[c].push_back(v);
+          --left;
+        } else
+          std::this_thread::yield();
+    });
+
+  for (std::thread &t : threads)
+    t.join();
+
+  // Every value popped exactly once, each producer's values in order
+  std::vector<int> count(producers * per_producer, 0);
+  bool ordered = true;
+
+  for (const auto &s : seen) {
+    std::vector<int> last(producers, -1);
+
+    for (int v : s) {
+      ++count[v];
+      ordered &= v > last[v / per_producer];
+      last[v / per_producer] = v;
+    }
+  }
+
+  REQUIRE(ordered);
+  REQUIRE(std::count(count.begin(), count.end(), 1) == int(count.size()));
+}
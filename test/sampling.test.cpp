@@ -0,0 +1,69 @@
+#include "catch.hpp"
+#include "sampling.hpp"
+#include <algorithm>
+
+namespace {
+
+bool distinct_sorted(const std::vector<unsigned> &v, unsigned n) {
+  for (unsigned i = 0; i < v.size(); ++i)
+    if (v[i] >= n || (i && v[i - 1] >= v[i]))
+      return false;
+
+  return true;
+}
+
+} // namespace
+
+TEST_CASE("sampling::uniform", "sampling") {
+  PRNG rng(1);
+  std::vector<unsigned> counts(10, 0), out;
+
+  for (int t = 0; t < 20000; ++t) {
+    out.clear();
+    Sampling::uniform(rng, 10, 3, out);
+
+    REQUIRE(out.size() == 3);
+    REQUIRE(distinct_sorted(out, 10));
+
+    for (unsigned i : out)
+      ++counts[i];
+  }
+
+  // Every index is picked 6000 times on average
+  for (unsigned c : counts)
+    REQUIRE(std::abs(int(c) - 6000) < 300);
+
+  out.clear();
+  Sampling::uniform(rng, 5, 7, out);
+  REQUIRE(out == (std::vector<unsigned>{0, 1, 2, 3, 4}));
+}
+
+TEST_CASE("sampling::normal", "sampling") {
+  PRNG rng(1);
+  std::vector<unsigned> counts(21, 0), out;
+
+  for (int t = 0; t < 20000; ++t) {
+    out.clear();
+    Sampling::normal(rng, 21, 1, 10, 3, out);
+    REQUIRE(distinct_sorted(out, 21));
+    ++counts[out[0]];
+  }
+
+  // Mass of [9.5, 10.5) is 0.1324, of [19.5, 20.5) 0.00077
+  REQUIRE(std::abs(int(counts[10]) - 2648) < 200);
+  REQUIRE(counts[20] < 50);
+  REQUIRE(counts[9] > counts[5]);
+  REQUIRE(counts[11] > counts[15]);
+
+  // Drawing every index still terminates with each index once
+  out.clear();
+  Sampling::normal(rng, 30, 30, 0, 1, out);
+  REQUIRE(out.size() == 30);
+  REQUIRE(distinct_sorted(out, 30));
+}
+
+TEST_CASE("sampling::seed", "sampling") {
+  REQUIRE(Sampling::seed(42, 1) == Sampling::seed(42, 1));
+  REQUIRE(Sampling::seed(42, 1) != Sampling::seed(42, 2));
+  REQUIRE(Sampling::seed(42, 1) != Sampling::seed(43, 1));
+}
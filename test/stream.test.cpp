@@ -0,0 +1,120 @@
+#include "catch.hpp"
+#include "stream.hpp"
+#include <cstdio>
+#include <iterator>
+
+namespace {
+
+std::string read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+TEST_CASE("stream::replay_buffer", "stream") {
+  ReplayBuffer replay(3);
+  sample_type x(1);
+
+  for (int k = 0; k < 5; ++k) {
+    x(0) = k;
+    replay.push_back(x, k, 1.0f);
+  }
+
+  // 3 and 4 replaced the two oldest samples in place
+  REQUIRE(replay.samples.size() == 3);
+  REQUIRE(replay.labels == (std::vector<float>{3, 4, 2}));
+  REQUIRE(replay.samples[0](0) == 3);
+  REQUIRE(replay.samples[2](0) == 2);
+
+  PRNG rng(1);
+  std::vector<unsigned> indices;
+  replay.batch(rng, 100, indices);
+
+  REQUIRE(indices.size() == 100);
+  for (unsigned i : indices)
+    REQUIRE(i < 3);
+}
+
+// generate() lives in data_gen.hpp, only compiled here through stream.hpp
+TEST_CASE("stream::generate_resume", "stream") {
+  const std::string input = "resume_test.pgn", output = "resume_test.csv";
+  // 20% of the winner's moves are sampled, so each game gets one sample
+  const std::string games[] = {
+      "1. e4 e6 2. d4 Ke7 3. Bg5+ Kd6 4. e5+ Kd5 5. Qf3+ Kxd4 6. Qe3+ Kd5 0-1",
+      "1. e4 e5 2. Nf3 d6 3. Bc4 Bg4 4. Nc3 g6 5. Nxe5 Bxd1 6. Bxf7+ Ke7 "
+      "7. Nd5# 1-0",
+      "1. e4 e5 2. Nf3 Nc6 3. Bc4 Nd4 4. Nxe5 Qg5 5. Nxf7 Qxg2 6. Rf1 Qxe4+ "
+      "7. Be2 Nf3# 0-1"};
+  {
+    std::ofstream out(input, std::ios::binary);
+    for (unsigned i = 0; i < 3; ++i)
+      out << "[Event \"Game " << i + 1 << "\"]\n\n" << games[i] << "\n\n";
+  }
+  const uint64_t input_size = read_file(input).size();
+
+  GenerateOptions options;
+  options.dedup = "none";
+  options.ingest.threads = 1;
+  options.alt_selection.top_k = 1;
+  options.alt_selection.depth = 2;
+  options.checkpoint_every = 1;
+
+  // Only the first game is written, its samples end the first shard
+  options.filter.max_ply = 12;
+  generate(input, output, options);
+  const std::string first = read_file(output);
+  REQUIRE(std::count(first.begin(), first.end(), '\n') > 2);
+
+  // The run is cut while writing the second game, its checkpoint after the
+  // first one: the chunk holds all the games, one of which was consumed
+  std::ofstream(output, std::ios::app | std::ios::binary) << "1,-2,3";
+
+  Checkpoint checkpoint;
+  checkpoint.input = input;
+  checkpoint.input_size = input_size;
+  checkpoint.skip = 1;
+  checkpoint.games = 1;
+  checkpoint.last_id = 1;
+  checkpoint.shard_bytes = first.size();
+  REQUIRE(checkpoint.save(output + ".ckpt"));
+
+  options.filter.max_ply = 0;
+  options.resume = true;
+  generate(input, output, options);
+
+  // The partial game is dropped and the other two go to a new shard
+  REQUIRE(read_file(output) == first);
+
+  const std::string second = read_file(output + ".1");
+  std::stringstream lines(second);
+  std::string line;
+  unsigned rows = 0;
+
+  REQUIRE(std::getline(lines, line));
+  REQUIRE(FeatureSchema::is_csv_comment(line));
+  REQUIRE(std::getline(lines, line));
+
+  while (std::getline(lines, line)) {
+    REQUIRE(line.find_last_of(',') != std::string::npos);
+    std::string label = line.substr(line.find_last_of(',') + 1);
+    REQUIRE((label == "Left" || label == "Right"));
+    ++rows;
+  }
+  REQUIRE(rows > 0);
+
+  REQUIRE(checkpoint.load(output + ".ckpt"));
+  REQUIRE(checkpoint.games == 3);
+  REQUIRE(checkpoint.last_id == 3);
+  REQUIRE(checkpoint.offset == input_size);
+  REQUIRE(checkpoint.shard == 1);
+  REQUIRE(checkpoint.shard_bytes == second.size());
+
+  // Resuming a finished run writes nothing
+  generate(input, output, options);
+  REQUIRE(read_file(output + ".2").empty());
+
+  for (std::string path : {input, output, output + ".1", output + ".ckpt"})
+    std::remove(path.c_str());
+}
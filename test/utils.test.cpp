@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "utils.hpp"
+#include <algorithm>
 #include <iostream>
 
 bool compare_alt_moves(std::vector<std::string> expected,
@@ -67,3 +68,42 @@ TEST_CASE("utils", "get_alt_moves") {
                                                         "d8a5", "c1d2", "g8f6"},
                                "d2a5")));
 }
+
+TEST_CASE("utils::select_alt_moves", "select_alt_moves") {
+  std::vector<std::string> init_moves{"e2e4", "d7d5"};
+  std::vector<std::string> see_losing{"f1c4", "f1a6", "d1g4"};
+  auto all = Utils::get_alt_moves(init_moves, "e4d5");
+
+  AltSelection selection;
+  PRNG rng(1);
+
+  // Every legal move by default
+  REQUIRE(compare_alt_moves(
+      all, Utils::select_alt_moves(init_moves, "e4d5", selection, rng)));
+
+  // Without the moves losing material in a static exchange
+  std::vector<std::string> safe;
+  for (auto m : all)
+    if (std::find(see_losing.begin(), see_losing.end(), m) == see_losing.end())
+      safe.push_back(m);
+
+  selection.see = true;
+  REQUIRE(compare_alt_moves(
+      safe, Utils::select_alt_moves(init_moves, "e4d5", selection, rng)));
+
+  // The k best safe moves, then a random tail of other safe ones
+  selection.top_k = 2;
+  selection.depth = 4;
+
+  for (unsigned tail : {0, 3}) {
+    selection.random_tail = tail;
+    auto alt_moves = Utils::select_alt_moves(init_moves, "e4d5", selection, rng);
+
+    REQUIRE(alt_moves.size() == 2 + tail);
+
+    for (auto m : alt_moves) {
+      REQUIRE(std::find(safe.begin(), safe.end(), m) != safe.end());
+      REQUIRE(std::count(alt_moves.begin(), alt_moves.end(), m) == 1);
+    }
+  }
+}